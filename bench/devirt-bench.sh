@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# Compare the throughput of the code optimized by canary -O2 with and without
+# -speculative-devirt, which rewrites the resolved pointer calls into direct
+# calls before the optimizations, so that e.g. the callbacks of libevent can
+# be inlined. For each app, both versions are built and run by the app's bench
+# script; the devirtualized calls, the average running time and the runs per
+# second are printed.
+#
+# Run `make` first, so that each app has its bit code file.
+#
+# Usage: devirt-bench.sh [-n <runs>] [<app>...]
+#   e.g. devirt-bench.sh -n 10 memcached
+
+runs=5
+apps="memcached transmission"
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -n) runs=$2; shift 2;;
+        --) shift; break;;
+        *) break;;
+    esac
+done
+
+if [ $# -gt 0 ]; then
+    apps="$@"
+fi
+
+for tool in canary clang++ bc; do
+    if ! which $tool > /dev/null 2>&1; then
+        echo "Error: $tool does not exist! Termination."
+        exit -1
+    fi
+done
+
+cd `dirname $0`
+
+printf "%-12s %-8s %10s %10s %10s\n" app devirt calls "time(s)" "runs/s"
+for app in $apps; do
+    for mode in off on; do
+        (
+            cd $app
+            opts="O2"
+            if [ $mode = on ]; then
+                opts="speculative-devirt -O2"
+            fi
+
+            log=$app.devirt-$mode.log
+            rm -f $app.t.bc
+            ./bench -c "$opts" > $log 2>&1
+            if [ ! -f $app.t.bc ]; then
+                echo "Error: canary fails on $app, see $app/$log"
+                exit 0
+            fi
+            ./bench -l pthread >> $log 2>&1
+
+            calls=`grep "# devirtualized pointer calls" $log | sed 's/.*: //'`
+            calls=`echo ${calls:-0} | awk '{print $1 + $3}'`
+
+            start=`date +%s.%N`
+            for i in `seq $runs`; do
+                ./bench -d > /dev/null 2>&1
+            done
+            end=`date +%s.%N`
+
+            elapsed=`echo "$end - $start" | bc -l`
+            printf "%-12s %-8s %10d %10.3f %10.3f\n" $app $mode $calls \
+                `echo "$elapsed / $runs" | bc -l` `echo "$runs / $elapsed" | bc -l`
+            rm -f $app.t.bc
+        )
+    done
+done
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+# Compare the code optimized by canary -O2 with -basicaa and with -dyckaa,
+# whose mod/ref summaries of the callees let the optimizer keep values in
+# registers across calls. For each app, both versions are built and run by
+# the app's bench script; the loads and stores left in the code, the narrowed
+# mod/ref results, and the average running time are printed.
+#
+# Run `make` first, so that each app has its bit code file.
+#
+# Usage: modref-bench.sh [-n <runs>] [<app>...]
+#   e.g. modref-bench.sh -n 10 pbzip2 racey
+
+runs=5
+apps="canneal pbzip2 pfscan racey simplerace"
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -n) runs=$2; shift 2;;
+        --) shift; break;;
+        *) break;;
+    esac
+done
+
+if [ $# -gt 0 ]; then
+    apps="$@"
+fi
+
+for tool in canary llvm-dis clang++ bc; do
+    if ! which $tool > /dev/null 2>&1; then
+        echo "Error: $tool does not exist! Termination."
+        exit -1
+    fi
+done
+
+cd `dirname $0`
+
+printf "%-12s %-8s %8s %8s %8s %10s\n" app aa loads stores narrowed "time(s)"
+for app in $apps; do
+    if [ ! -f $app/$app.bc ]; then
+        echo "Error: $app/$app.bc does not exist, please run make first."
+        continue
+    fi
+
+    for aa in basicaa dyckaa; do
+        (
+            cd $app
+            log=$app.$aa.log
+            if ! canary -lowerinvoke -$aa -O2 -stats $app.bc -o $app.t.bc > $log 2>&1; then
+                echo "Error: canary fails on $app with -$aa, see $app/$log"
+                exit 0
+            fi
+            ./bench -l pthread > /dev/null 2>&1
+
+            loads=`llvm-dis $app.t.bc -o - | grep -c " = load "`
+            stores=`llvm-dis $app.t.bc -o - | grep -c "^ *store "`
+            narrowed=`grep "Number of call mod/ref results narrowed" $log | awk '{print $1}'`
+
+            start=`date +%s.%N`
+            for i in `seq $runs`; do
+                ./bench -d > /dev/null 2>&1
+            done
+            end=`date +%s.%N`
+
+            printf "%-12s %-8s %8d %8d %8d %10.3f\n" $app $aa $loads $stores ${narrowed:-0} \
+                `echo "($end - $start) / $runs" | bc -l`
+            rm -f $app.t.bc
+        )
+    done
+done
@@ -0,0 +1,56 @@
+/*
+ * File:   SpeculativeDevirt.h
+ *
+ * Rewrite the pointer calls resolved by the alias analysis into direct
+ * calls, so that the optimizations after it, e.g. inlining, can see their
+ * callees. A pointer call that may call only a few functions is guarded:
+ *
+ *     if (fp == f1) f1(...); else if (fp == f2) f2(...); else fp(...);
+ *
+ * and a must-aliased one, i.e. a function via casts or aliases, is called
+ * directly. Creating the pass preserves the call graph of the alias
+ * analysis, as -preserve-dyck-callgraph does.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef SPECULATIVEDEVIRT_H
+#define SPECULATIVEDEVIRT_H
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+class SpeculativeDevirt : public ModulePass {
+private:
+    unsigned guarded_num;
+    unsigned direct_num;
+
+public:
+    static char ID; // Class identification, replacement for typeinfo
+
+    SpeculativeDevirt();
+
+    virtual bool runOnModule(Module &M);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+
+private:
+    /// Compare the called value with each target, call the matched one
+    /// directly, and keep the pointer call as the fallback.
+    void devirtualize(CallInst* call, const vector<Function*>& targets);
+
+    /// Replace the pointer call with a direct call to the function.
+    void callDirectly(CallInst* call, Function* callee);
+};
+
+llvm::ModulePass *createSpeculativeDevirtPass();
+
+#endif
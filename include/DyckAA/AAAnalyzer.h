@@ -12,6 +12,8 @@
 
 #include "DyckAA/EdgeLabel.h"
 #include "DyckAA/DyckAliasAnalysis.h"
+#include "DyckAA/FunctionSummary.h"
+#include "DyckAA/Progress.h"
 #include <map>
 #include <unordered_map>
 
@@ -23,6 +25,10 @@ typedef struct FunctionTypeNode {
 	FunctionType * type;
 	FunctionTypeNode * root;
 	set<Function *> compatibleFuncs;
+
+	/// compatibleFuncs bucketed by their representatives, which are
+	/// refreshed at the beginning of each inter-procedure iteration
+	map<DyckVertex*, set<Function *>> compatibleFuncsByRep;
 } FunctionTypeNode;
 
 class AAAnalyzer {
@@ -36,8 +42,39 @@ private:
 	map<Type*, FunctionTypeNode*> functionTyNodeMap;
 	set<FunctionTypeNode *> tyroots;
 
+	/// common calls that have been handled by the inter-procedure analysis
+	map<DyckCallGraphNode*, set<CommonCall*>> handledCommonCalls;
+
+	/// In the demand-driven mode, only the calls that may change the
+	/// demanded vertices are handled: the vertices of the demanded values,
+	/// the ones they reach, whose classes and targets the queries read, and
+	/// the ones reaching those, which are combined into them by qirun's
+	/// algorithm. Other calls only combine vertices out of this set, see
+	/// compute_demanded_vertices. The demanded functions are the ones with
+	/// parameters or returns in the set.
+	bool demandDriven;
+	set<Value*> demandedValues;
+	set<DyckVertex*> demandedTargets;
+	set<DyckVertex*> demandedVertices;
+	set<Function*> demandedFuncs;
+
+	/// The summary of the function being scanned, NULL if not recording.
+	/// Only the outermost operations are recorded, e.g. wrapping a
+	/// constant is recorded but the operations done for it are not.
+	FunctionSummary* summary;
+	unsigned summaryDepth;
+
+	/// The vertices that have been combined or have got new targets while
+	/// the direct calls of an SCC are handled, NULL if not collected.
+	set<DyckVertex*>* touchedVertices;
+
+	/// Values that are known to be pointer-equivalent before the analysis,
+	/// e.g. a cast and its operand, mapped to the first of them. They share
+	/// one vertex, see number_values().
+	unordered_map<Value*, Value*> canonicalValues;
+
 public:
-	AAAnalyzer(Module* m, DyckAliasAnalysis* a, DyckGraph* d, DyckCallGraph* cg);
+	AAAnalyzer(Module* m, DyckAliasAnalysis* a, DyckGraph* d, DyckCallGraph* cg, bool demand = false);
 	~AAAnalyzer();
 
 	void start_intra_procedure_analysis();
@@ -49,9 +86,20 @@ public:
 	void intra_procedure_analysis();
 	void inter_procedure_analysis();
 
+	/// Demand the values, and handle the calls that may change them until
+	/// the fixpoint, unless the values are only reached from the values
+	/// demanded before. NULL demands all the values and ends the
+	/// demand-driven mode. Return true if the graph may have been changed.
+	bool demand_inter_procedure_analysis(set<Value*>* values);
+
 private:
 	void printNoAliasedPointerCalls();
 
+	/// Find pointer-equivalent values by hash-based value numbering:
+	/// casts, PHIs and selects whose operands are equivalent, GEPs without
+	/// struct indices, and identical GEPs.
+	void number_values();
+
 private:
 	void handle_inst(Instruction *inst, DyckCallGraphNode * parent);
 	void handle_instrinsic(Instruction *inst);
@@ -60,17 +108,40 @@ private:
 	void handle_invoke_call_inst(Instruction * ret, Value* cv, vector<Value*>* args, DyckCallGraphNode * parent);
 	void handle_lib_invoke_call_inst(Value* ret, Function* f, vector<Value*>* args, DyckCallGraphNode* parent);
 
+	/// Replay the operations of a summary instead of scanning the function.
+	void replay_summary(FunctionSummary* fs, DyckCallGraphNode* parent);
+
 private:
-	bool handle_pointer_function_calls(DyckCallGraphNode* caller, int counter);
+	bool handle_pointer_function_calls(DyckCallGraphNode* caller, Progress& progress);
+	bool handle_common_function_calls(DyckCallGraphNode* caller);
 	void handle_common_function_call(Call* c, DyckCallGraphNode* caller, DyckCallGraphNode* callee);
 
+	/// Return true if the call may change the demanded vertices by its
+	/// arguments, its return, or the callee, which is NULL for a pointer
+	/// call, see isDemanded(PointerCall*).
+	bool isDemanded(Call* c, Function* callee);
+
+	/// Return true if the pointer call may change the demanded vertices,
+	/// including by a function of its type that is demanded.
+	bool isDemanded(PointerCall* c, FunctionType* fty);
+
+	bool isDemanded(Value* v) {
+		DyckVertex* rep = dgraph->findDyckVertex(v);
+		return rep != NULL && demandedVertices.count(rep);
+	}
+
+	/// Compute the demanded vertices and functions from the demanded values.
+	void compute_demanded_vertices();
+
 private:
 	int isCompatible(FunctionType * t1, FunctionType * t2);
-	set<Function*>* getCompatibleFunctions(FunctionType * fty);
+	set<Function*>* getCompatibleFunctions(FunctionType * fty, DyckVertex* rep);
+	Function* getCalledFunction(Value* calledValue);
 
 	FunctionTypeNode* initFunctionGroup(FunctionType* fty);
 	void initFunctionGroups();
 	void destroyFunctionGroups();
+	void bucketFunctionGroups();
 	void combineFunctionGroups(FunctionType * ft1, FunctionType* ft2);
 
 private:
@@ -78,6 +149,14 @@ private:
 	DyckVertex* addPtrTo(DyckVertex* address, DyckVertex* val);
 	DyckVertex* makeAlias(DyckVertex* x, DyckVertex* y);
 	void makeContentAlias(DyckVertex* x, DyckVertex* y);
+	void addEdge(DyckVertex* from, DyckVertex* to, EdgeLabel::LABEL_TY kind, long num);
+
+	void addCommonCall(DyckCallGraphNode* parent, Instruction* ret, Function* f, vector<Value*>* args);
+	void addPointerCall(DyckCallGraphNode* parent, Instruction* ret, Value* cv, vector<Value*>* args);
+
+	bool recording() {
+		return summary != NULL && summaryDepth == 0;
+	}
 
 	DyckVertex* handle_gep(GEPOperator* gep);
 	DyckVertex* wrapValue(Value * v);
@@ -0,0 +1,82 @@
+/*
+ * File:   AllocSiteIndex.h
+ *
+ * An index of the allocation sites of a module, i.e. global variables,
+ * functions, allocas and calls to allocators, built once after the
+ * analysis. The sites of each representative, and the representative of
+ * each site, are kept in flat arrays, so that both directions are looked
+ * up in constant time. The index can be saved for runtime tools, e.g. to
+ * tag the objects allocated by each site.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef ALLOCSITEINDEX_H
+#define	ALLOCSITEINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Module.h"
+#include "DyckGraph/DyckGraph.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+class AllocSiteIndex {
+private:
+	/// sites in the order of the module
+	vector<Value*> sites;
+	DenseMap<Value*, unsigned> siteNumbers;
+
+	/// representatives that have sites, in the order of their first sites
+	vector<DyckVertex*> reps;
+	DenseMap<DyckVertex*, unsigned> repNumbers;
+
+	/// the representative of each site
+	vector<unsigned> siteReps;
+
+	/// the sites of representative i are repSites[repOffsets[i] .. repOffsets[i + 1])
+	vector<unsigned> repOffsets;
+	vector<Value*> repSites;
+
+	DyckGraph* dgraph;
+
+	/// the allocators, and their representatives for the pointer calls
+	DenseSet<Function*> allocatorFuncs;
+	DenseSet<DyckVertex*> allocatorReps;
+
+public:
+	/// The graph must not change any more.
+	AllocSiteIndex(Module* M, DyckGraph* dgraph, const std::set<Function*>& allocators);
+
+	/// The sites of the representative, empty if it has none.
+	ArrayRef<Value*> getSites(DyckVertex* rep) const;
+
+	/// The representative of a site, NULL if it is not a site.
+	DyckVertex* getRepresentative(Value* site) const;
+
+	/// Whether a called value is an allocator, or a pointer aliased with one.
+	bool isAllocator(Value* calledValue) const;
+
+	unsigned numSites() const {
+		return sites.size();
+	}
+
+	unsigned numRepresentatives() const {
+		return reps.size();
+	}
+
+	/// Save the index into a text file, see AllocSiteIndex.cpp for the format.
+	bool save(const std::string& file) const;
+
+private:
+	void addSite(Value* site);
+};
+
+#endif	/* ALLOCSITEINDEX_H */
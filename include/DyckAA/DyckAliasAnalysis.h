@@ -13,6 +13,7 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -25,12 +26,17 @@
 #include "DyckGraph/DyckGraph.h"
 #include "DyckCG/DyckCallGraph.h"
 #include "DyckAA/AAAnalyzer.h"
+#include "DyckAA/LibrarySpec.h"
+#include "DyckAA/AllocSiteIndex.h"
 
 #include <set>
+#include <mutex>
 
 using namespace llvm;
 using namespace std;
 
+class AAAnalyzer;
+
 class DyckAliasAnalysis: public ModulePass, public AliasAnalysis {
 public:
 	static char ID; // Class identification, replacement for typeinfo
@@ -54,12 +60,22 @@ public:
 	}
 
 	/// Get the may/must alias set.
+	/// If the analysis is frozen, an empty set is returned for a value
+	/// that is not in the graph.
 	virtual const set<Value*>* getAliasSet(Value * ptr) const;
 
-	virtual ModRefResult getModRefInfo(ImmutableCallSite CS, const Location &Loc) {
-		return AliasAnalysis::getModRefInfo(CS, Loc);
+	/// Freeze the analysis after runOnModule. The graph cannot be changed
+	/// any more, and all the queries can be issued by multiple threads.
+	void freeze();
+
+	bool isFrozen() {
+		return dyck_graph->isFrozen();
 	}
 
+	/// The result of the chained analyses is narrowed by the mod/ref
+	/// summary of the callees, see computeModRefSummaries.
+	virtual ModRefResult getModRefInfo(ImmutableCallSite CS, const Location &Loc);
+
 	virtual ModRefResult getModRefInfo(ImmutableCallSite CS1, ImmutableCallSite CS2) {
 		return AliasAnalysis::getModRefInfo(CS1, CS2);
 	}
@@ -74,16 +90,19 @@ public:
 	/// getModRefBehavior - Return the behavior when calling the given
 	/// call site.
 
-	virtual ModRefBehavior getModRefBehavior(ImmutableCallSite CS) {
-		return AliasAnalysis::getModRefBehavior(CS);
-	}
+	virtual ModRefBehavior getModRefBehavior(ImmutableCallSite CS);
 
 	/// getModRefBehavior - Return the behavior when calling the given function.
 	/// For use when the call site is not known.
 
-	virtual ModRefBehavior getModRefBehavior(const Function *F) {
-		return AliasAnalysis::getModRefBehavior(F);
-	}
+	virtual ModRefBehavior getModRefBehavior(const Function *F);
+
+	/// The optimizations tell when they delete or clone a value, so that
+	/// the mod/ref summary of a deleted call is not picked up by a new one
+	/// allocated at its address, and a cloned call keeps the summary.
+	virtual void deleteValue(Value *V);
+
+	virtual void copyValue(Value *From, Value *To);
 
 	/// getAdjustedAnalysisPointer - This method is used when a pass implements
 	/// an analysis interface through multiple inheritance.  If needed, it
@@ -100,8 +119,68 @@ private:
 	DyckGraph* dyck_graph;
 	DyckCallGraph * call_graph;
 
+	/// how the library functions affect the aliases
+	LibrarySpec* lib_spec;
+
 	std::set<Function*> mem_allocas;
-	map<DyckVertex*, std::vector<Value*>*> vertexMemAllocaMap;
+
+	/// built when it is first used, after all the calls are resolved
+	AllocSiteIndex* alloc_sites;
+	Module* module;
+
+	/// Call sites of each function, recorded by AAAnalyzer when it builds
+	/// the call graph, including the resolved pointer calls.
+	map<Function*, set<Instruction*>> calleeCallSitesMap;
+
+	/// Vertices escaped to each function, computed on demand.
+	map<Function*, set<DyckVertex*>*> escapedToMap;
+
+	/// Alias results of pairs of representatives (the smaller one first),
+	/// so that the values in the same alias sets share one entry.
+	DenseMap<pair<DyckVertex*, DyckVertex*>, AliasResult> repAliasCache;
+
+	/// guards the lazily filled caches above
+	std::mutex cacheMutex;
+
+	/// guards the queries to the chained analyses, which are not thread-safe;
+	/// they may query this analysis again, e.g. getModRefInfo asks alias
+	std::recursive_mutex chainMutex;
+
+	/// What a function, or a call, may modify and reference: the
+	/// representatives of the pointers it accesses memory through, closed
+	/// over the offset edges and sorted, or all the memory. A call that may
+	/// allocate memory returns a new object each time, so it is never
+	/// reported as readnone or readonly, or it may be merged by e.g. GVN.
+	struct ModRefSummary {
+		vector<DyckVertex*> mods;
+		vector<DyckVertex*> refs;
+		bool modAll;
+		bool refAll;
+		bool allocates;
+
+		ModRefSummary() :
+				modAll(false), refAll(false), allocates(false) {
+		}
+
+		ModRefBehavior getBehavior() const {
+			bool mod = modAll || !mods.empty();
+			bool ref = refAll || !refs.empty();
+			if (mod || allocates) {
+				return UnknownModRefBehavior;
+			}
+			return ref ? OnlyReadsMemory : DoesNotAccessMemory;
+		}
+	};
+
+	/// Summaries of the defined functions, shared by the functions of an
+	/// SCC of the call graph, and of the pointer calls and the calls to
+	/// library functions, computed after all the calls are resolved.
+	DenseMap<const Value*, ModRefSummary*> modRefSummaries;
+	vector<ModRefSummary*> modRefSummaryList;
+
+	/// In the demand-driven mode (-dyckaa-demand-driven), the analyzer is
+	/// kept after runOnModule to resolve the calls of queried values.
+	AAAnalyzer* demand_analyzer;
 
 private:
 	friend class AAAnalyzer;
@@ -110,12 +189,16 @@ private:
 	map<long, EdgeLabel*> OFFSET_LABEL_MAP;
 	map<long, EdgeLabel*> INDEX_LABEL_MAP;
 
+	SlabAllocator<DerefEdgeLabel, 1> derefLabelAllocator;
+	SlabAllocator<PointerOffsetEdgeLabel, 64> offsetLabelAllocator;
+	SlabAllocator<FieldIndexEdgeLabel, 64> indexLabelAllocator;
+
 private:
 	EdgeLabel* getOrInsertOffsetEdgeLabel(long offset) {
 		if (OFFSET_LABEL_MAP.count(offset)) {
 			return OFFSET_LABEL_MAP[offset];
 		} else {
-			EdgeLabel* ret = new PointerOffsetEdgeLabel(offset);
+			EdgeLabel* ret = offsetLabelAllocator.create(offset);
 			OFFSET_LABEL_MAP.insert(pair<long, EdgeLabel*>(offset, ret));
 			return ret;
 		}
@@ -125,13 +208,47 @@ private:
 		if (INDEX_LABEL_MAP.count(offset)) {
 			return INDEX_LABEL_MAP[offset];
 		} else {
-			EdgeLabel* ret = new FieldIndexEdgeLabel(offset);
+			EdgeLabel* ret = indexLabelAllocator.create(offset);
 			INDEX_LABEL_MAP.insert(pair<long, EdgeLabel*>(offset, ret));
 			return ret;
 		}
 	}
 
 private:
+	void addCallSite(Function* callee, Instruction* call);
+	void removeCallSite(Function* callee, Instruction* call);
+
+private:
+	/// Resolve the calls that the value may depend on in the demand-driven
+	/// mode, i.e. the calls that may change the vertices reaching or reached
+	/// from its vertex, see AAAnalyzer::compute_demanded_vertices. The
+	/// caches are cleared if the graph is changed.
+	void demand(const Value* v);
+
+	/// Finish the demand-driven mode by resolving all the calls.
+	void demandAll();
+
+	void invalidateCaches();
+
+private:
+	/// Compute the mod/ref summaries bottom-up over the SCCs of the call
+	/// graph built with the resolved pointer calls. The graph must not
+	/// change any more.
+	void computeModRefSummaries();
+
+	/// Add what a call may access into the summary, which is the callee's
+	/// summary for a defined callee.
+	void addCallModRef(ModRefSummary* s, CallSite cs, Function* callee);
+
+	/// Add what a pointer may access, or all the memory if it is not in the graph.
+	void addPointerModRef(ModRefSummary* s, Value* ptr, bool mod, bool ref);
+
+	/// The summary of the callees of the call, NULL if unknown.
+	const ModRefSummary* getModRefSummary(ImmutableCallSite CS);
+
+private:
+	/// The alias result of two representatives in the graph, cached.
+	AliasResult aliasRepresentatives(DyckVertex* VA, DyckVertex* VB);
 
 	/// Determine whether the object that VB points to can be got by
 	/// extractvalue instruction from the object VA points to.
@@ -144,6 +261,10 @@ private:
 	///     The summary of the evaluation will be printed to the console
 	void printAliasSetInformation(Module& M);
 
+	/// Save the part of the analysis that other modules can see into a
+	/// file, see ModuleSummary.
+	void exportSummary(Module& M, const std::string& file);
+
 	void getEscapedPointersTo(set<DyckVertex*>* ret, Function * func); // escaped to 'func'
 	void getEscapedPointersFrom(set<DyckVertex*>* ret, Value * from); // escaped from 'from'
 
@@ -157,6 +278,15 @@ public:
 	bool callGraphPreserved();
 	DyckCallGraph* getCallGraph();
 
+	/// The same as -preserve-dyck-callgraph, for the passes that need the
+	/// call graph. It must be called before the analysis runs, e.g. when
+	/// such a pass is created.
+	static void preserveCallGraph();
+
+	LibrarySpec* getLibrarySpec() {
+		return lib_spec;
+	}
+
 	DyckGraph* getDyckGraph() {
 	    return dyck_graph;
 	}
@@ -173,32 +303,27 @@ public:
     /// For a global variable @q, since its memory location is allocated
     /// statically, itself will be returned.
     ///
-    /// Default mem alloca function includes
-    /// {
-    ///    "calloc", "malloc", "realloc",
-    ///    "_Znaj", "_ZnajRKSt9nothrow_t",
-    ///    "_Znam", "_ZnamRKSt9nothrow_t",
-    ///    "_Znwj", "_ZnwjRKSt9nothrow_t",
-    ///    "_Znwm", "_ZnwmRKSt9nothrow_t"
-    /// }
+    /// Default mem alloca functions are the allocators in the library
+    /// specs, see LibrarySpec.h.
     ///
     /// For a pointer that points to a struct or class field, this interface
     /// may return you nothing, because the field may be initialized using
     /// the same allocation instruction as the struct or class. For example
     /// %addr = alloca {int, int} not only initializes the memory %addr points to,
     /// but also initializes the memory gep %addr 0 and gep %addr 1 point to.
-    std::vector<Value*>* getDefaultPointstoMemAlloca(Value* pointer);
-
-    /// Default mem alloca function includes
-    /// {
-    ///    "calloc", "malloc", "realloc",
-    ///    "_Znaj", "_ZnajRKSt9nothrow_t",
-    ///    "_Znam", "_ZnamRKSt9nothrow_t",
-    ///    "_Znwj", "_ZnwjRKSt9nothrow_t",
-    ///    "_Znwm", "_ZnwmRKSt9nothrow_t"
-    /// }
+    ///
+    /// The result is looked up in the allocation site index, which is kept
+    /// until the analysis is released.
+    ArrayRef<Value*> getDefaultPointstoMemAlloca(Value* pointer);
+
+    /// Whether the called value is a default mem alloca function, or a
+    /// pointer aliased with one.
     bool isDefaultMemAllocaFunction(Value* calledValue);
 
+    /// The allocation sites of all the representatives. It is built when it
+    /// is first used, which resolves all the calls in the demand-driven mode.
+    AllocSiteIndex* getAllocSiteIndex();
+
 };
 
 llvm::ModulePass *createDyckAliasAnalysisPass();
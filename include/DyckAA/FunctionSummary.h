@@ -0,0 +1,135 @@
+/*
+ * File:   FunctionSummary.h
+ *
+ * A summary of the intra-procedure analysis of a function, i.e. the
+ * operations on the Dyck graph and on the call graph done when the
+ * function is scanned. Values are referred to by their positions in the
+ * function, so that a summary can be saved into a cache directory and be
+ * replayed on the same function of a later build instead of scanning it.
+ * Constants are not summarized but wrapped again when a summary is
+ * replayed, because they may be shared by other functions.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef FUNCTIONSUMMARY_H
+#define	FUNCTIONSUMMARY_H
+
+#include "llvm/IR/Function.h"
+#include "DyckGraph/DyckVertex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+class FunctionSummary {
+public:
+	enum OpKind {
+		WRAP, // wrapValue(value)
+		DEREF, // addPtrTo(vertex, vertex)
+		FIELD, // addField(vertex, num, vertex)
+		ALIAS, // makeAlias(vertex, vertex)
+		OFFSET_EDGE, // vertex --@num--> vertex
+		INDEX_EDGE, // vertex --#num--> vertex
+		CAST_COMB, // combineFunctionGroups of a cast instruction
+		RET, // addRet(value)
+		RESUME, // addResume(value)
+		INLINE_ASM, // addInlineAsm(instruction)
+		VA_ARG, // addVAArg(instruction)
+		COMMON_CALL, // names: caller, callee; refs: ret, args...
+		POINTER_CALL, // names: caller; refs: ret, called value, args...
+		OP_KIND_NUM
+	};
+
+	/// A reference to a value or a vertex.
+	struct Ref {
+		char kind; // 'a' argument, 'i' instruction, 'o' operand, 'v' vertex, 'n' none
+		unsigned idx; // of the argument, the instruction, or the vertex
+		unsigned opnd; // operand opnd of the instruction idx
+	};
+
+	struct Op {
+		OpKind kind;
+		long num;
+		vector<std::string> names;
+		vector<Ref> refs;
+	};
+
+private:
+	Function* func;
+
+	vector<Argument*> args;
+	vector<Instruction*> insts;
+	map<Value*, unsigned> localIndices;
+
+	vector<Op> ops;
+
+	/// the number of vertices returned by the ops, i.e. WRAP, DEREF, FIELD
+	/// and ALIAS ops, the i-th of which is referred to as ('v', i)
+	unsigned vertexNum;
+
+	/// false if an operation cannot be summarized
+	bool valid;
+
+	// recording
+	unsigned current;
+	map<DyckVertex*, unsigned> vertexIndices;
+
+public:
+	FunctionSummary(Function* f);
+
+	/// A structural hash of the function, including its name, its type and
+	/// its body, but not the debug information.
+	static uint64_t hash(Function* f);
+
+	bool isValid() {
+		return valid;
+	}
+
+	/// Load a saved summary. False if the file does not exist, or it does
+	/// not match the function.
+	bool load(const std::string& file);
+
+	bool save(const std::string& file);
+
+	vector<Op>& getOps() {
+		return ops;
+	}
+
+	unsigned getVertexNum() {
+		return vertexNum;
+	}
+
+	/// The value that a reference ('a', 'i' or 'o') refers to.
+	Value* getValue(const Ref& r);
+
+public:
+	/// The instruction being scanned, whose operands can be referred to.
+	void setCurrentInstruction(Instruction* inst);
+
+	Ref value(Value* v);
+	Ref vertex(DyckVertex* v);
+
+	/// Record an op; if it returns a vertex, ret is the vertex.
+	void record(OpKind kind, long num, const vector<Ref>& refs, DyckVertex* ret = NULL);
+	void record(OpKind kind, const vector<std::string>& names, const vector<Ref>& refs);
+
+	/// The vertices will not be referred to any more, because they are
+	/// combined into others.
+	void forget(DyckVertex* x, DyckVertex* y);
+
+	static Ref none() {
+		Ref r = { 'n', 0, 0 };
+		return r;
+	}
+
+private:
+	/// Whether a loaded op has the right references.
+	bool checkOp(const Op& op);
+};
+
+#endif	/* FUNCTIONSUMMARY_H */
@@ -0,0 +1,108 @@
+/*
+ * File:   LibrarySpec.h
+ *
+ * How the library functions, which are declared but not defined in the
+ * module, affect the aliases, e.g. strcpy returns its first argument. The
+ * built-in spec models libc, libstdc++ and pthread; more specs can be loaded
+ * from files (-dyckaa-lib-spec), e.g. for in-house allocators and thread
+ * pools. Each line of a spec is
+ *
+ *     <function> <number of arguments, or *> <relation>...
+ *
+ * and a relation is one of
+ *
+ *     alloc           it returns a newly allocated object
+ *     alias(x,y)      x and y are aliases
+ *     content(x,y)    what x points to and what y points to are aliases
+ *     keyvalue(x,y)   y is the value of the key x, e.g. pthread_setspecific
+ *     spawn(x,y)      it calls x with the argument y, e.g. pthread_create
+ *     mod(x)          it may write what x points to
+ *     ref(x)          it may read what x points to
+ *     nomem           it accesses no memory of the program
+ *
+ * where x and y are r (the return value), or 1, 2, ... (the arguments),
+ * and x of mod and ref must be an argument. A function with mod, ref or
+ * nomem accesses nothing else, which the mod/ref summaries rely on; the
+ * memory accesses of the others are unknown, unless their attributes tell.
+ * An allocator, and any function that may call one, still returns a new
+ * object each time, so its calls are never reported as readnone/readonly.
+ * Text after # is a comment. A later line of the same function and the same
+ * number of arguments replaces the earlier one.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef LIBRARYSPEC_H
+#define	LIBRARYSPEC_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Module.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+class LibrarySpec {
+public:
+	enum RelationKind {
+		ALIAS, CONTENT_ALIAS, KEY_VALUE, SPAWN, MOD, REF
+	};
+
+	/// the position of the return value in a relation
+	static const unsigned RET = 0;
+
+	struct Relation {
+		RelationKind kind;
+		unsigned x; // RET, or the x-th argument
+		unsigned y; // the same as x for mod and ref
+	};
+
+	struct FunctionSpec {
+		std::string name;
+		int argNum; // -1 for any number of arguments
+		bool alloc;
+		bool knownAccesses; // it has mod, ref or nomem
+		vector<Relation> relations;
+	};
+
+private:
+	vector<FunctionSpec> specs;
+
+	/// specs of the functions in the module, filled by bind()
+	DenseMap<const Function*, vector<const FunctionSpec*> > table;
+
+	vector<Function*> allocators;
+
+public:
+	/// The built-in spec is loaded.
+	LibrarySpec();
+
+	/// Load the spec in a file. If it fails, error is set and false is returned.
+	bool load(const std::string& file, std::string& error);
+
+	/// Find the functions of the specs in the module. It must be called
+	/// after all the specs are loaded.
+	void bind(Module& M);
+
+	/// The spec of a call to f with argNum arguments, NULL if none.
+	const FunctionSpec* lookup(const Function* f, unsigned argNum) const;
+
+	/// The functions in the module that return newly allocated objects.
+	const vector<Function*>& getAllocators() const {
+		return allocators;
+	}
+
+	/// A hash of all the specs, which changes if any spec changes.
+	uint64_t fingerprint() const;
+
+private:
+	bool parse(std::istream& is, const std::string& source, std::string& error);
+
+	void add(const FunctionSpec& spec);
+};
+
+#endif	/* LIBRARYSPEC_H */
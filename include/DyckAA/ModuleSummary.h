@@ -0,0 +1,79 @@
+/*
+ * File:   ModuleSummary.h
+ *
+ * A summary of the alias analysis of a module (a translation unit), which
+ * is used to analyze a program module by module. Each module is analyzed
+ * separately (-dyckaa-export-summary), and its summary only keeps what the
+ * other modules can see: the vertices of the symbols visible outside, the
+ * parameters and returns of the functions, the calls whose callees may be
+ * defined in other modules, and all the vertices reachable from them with
+ * their edges. dyckmerge merges the summaries by the names of the symbols
+ * and computes the fixpoint of unification and indirect calls over them.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef MODULESUMMARY_H
+#define	MODULESUMMARY_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class ModuleSummary {
+public:
+	/// no vertex, e.g. the return value of a void call
+	static const unsigned NONE = ~0U;
+
+	struct Edge {
+		unsigned from;
+		char kind; // 'd' deref, 'o' offset, 'i' index
+		long num;
+		unsigned to;
+	};
+
+	/// A function that is visible outside, or whose address is taken.
+	/// A local function is named "<module>:<function>".
+	struct FunctionInfo {
+		std::string name;
+		bool defined;
+		bool varArg;
+		unsigned vertex; // NONE if its address is not taken in the module
+		vector<unsigned> params;
+		vector<unsigned> rets;
+		vector<unsigned> vaargs;
+	};
+
+	/// A call to a function declared in the module, or a pointer call.
+	struct CallInfo {
+		std::string caller;
+		std::string callee; // empty for a pointer call
+		unsigned calledValue;
+		unsigned ret;
+		vector<unsigned> args;
+		vector<std::string> callees; // resolved callees of a pointer call
+	};
+
+public:
+	std::string module;
+	unsigned vertexNum;
+	vector<Edge> edges;
+	vector<pair<std::string, unsigned> > globals;
+	vector<FunctionInfo> functions;
+	vector<CallInfo> calls;
+
+public:
+	ModuleSummary() :
+			vertexNum(0) {
+	}
+
+	bool save(const std::string& file);
+
+	/// False if the file cannot be read, or it is not a valid summary.
+	bool load(const std::string& file);
+};
+
+#endif	/* MODULESUMMARY_H */
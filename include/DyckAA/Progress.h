@@ -0,0 +1,59 @@
+/*
+ * File:   Progress.h
+ *
+ * Progress of a long-running phase, e.g. resolving indirect calls. The
+ * progress is printed into the console only if it is a terminal, and at
+ * most once per -progress-interval milliseconds. If -progress-fd is set,
+ * the start, each printed update and the finish are also written into the
+ * file descriptor as lines like
+ *
+ *     progress event=update phase="<phase>" done=<n> total=<n> eta=<seconds>
+ *
+ * so that other tools can follow the analysis.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef PROGRESS_H
+#define	PROGRESS_H
+
+#include <chrono>
+#include <string>
+
+class Progress {
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::string phase;
+	unsigned long done;
+	unsigned long total;
+
+	Clock::time_point startTime;
+	Clock::time_point lastTime;
+
+	bool console; // printing into the console
+	bool finished;
+
+public:
+	Progress(const char* phase, unsigned long total);
+	~Progress();
+
+	/// One more unit of work is done.
+	void step() {
+		update(done + 1);
+	}
+
+	void update(unsigned long done);
+
+	/// Clear the line in the console and emit the last event.
+	void finish();
+
+private:
+	/// Estimated seconds to finish, -1 if unknown.
+	long eta(Clock::time_point now);
+
+	void emit(const char* event, Clock::time_point now);
+};
+
+#endif	/* PROGRESS_H */
@@ -17,6 +17,8 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -25,6 +27,7 @@
 #include "llvm/Support/CommandLine.h"
 
 #include "DyckCallGraphNode.h"
+#include "DyckGraph/SlabAllocator.h"
 
 #include <set>
 #include <map>
@@ -37,41 +40,122 @@ using namespace std;
 
 class DyckCallGraph {
 private:
-     typedef std::map<Function *, DyckCallGraphNode *> FunctionMapTy;
-    FunctionMapTy FunctionMap;
+    // nodes in the order of their creation, which is the order of the
+    // module, and their positions, i.e. their indices
+    vector<DyckCallGraphNode *> nodes;
+    DenseMap<Function *, unsigned> nodeIndices;
+
+    // the edges built by build() in CSR form: the callees of node i are
+    // callees[calleeOffsets[i] .. calleeOffsets[i + 1]), sorted by index,
+    // and so are its callers
+    vector<unsigned> calleeOffsets;
+    vector<unsigned> callees;
+    vector<unsigned> callerOffsets;
+    vector<unsigned> callers;
+
+    // SCC k is sccNodes[sccOffsets[k] .. sccOffsets[k + 1]), which follows
+    // all the SCCs it reaches, i.e. callees first
+    vector<unsigned> sccOffsets;
+    vector<unsigned> sccNodes;
+    vector<unsigned> nodeSCCs;
+
+    // callers before callees, the reverse of sccNodes
+    vector<unsigned> topologicalOrder;
+
+    // calls of all the nodes are released together with the call graph
+    SlabAllocator<CommonCall> commonCallAllocator;
+    SlabAllocator<PointerCall> pointerCallAllocator;
 
 public:
+    typedef vector<DyckCallGraphNode *>::iterator iterator;
 
     ~DyckCallGraph() {
-        FunctionMapTy::iterator it = FunctionMap.begin();
-        while (it != FunctionMap.end()) {
-            delete (it->second);
-            it++;
+        for (auto node : nodes) {
+            delete node;
         }
-        FunctionMap.clear();
+        nodes.clear();
     }
 
 public:
-    
-   FunctionMapTy::iterator begin(){
-        return FunctionMap.begin();
+    /// Nodes in the order of their creation. Creating nodes invalidates
+    /// the iterators, use size() and getNode(i) then.
+    iterator begin() {
+        return nodes.begin();
     }
-    
-    FunctionMapTy::iterator end(){
-        return FunctionMap.end();
+
+    iterator end() {
+        return nodes.end();
+    }
+
+    unsigned size() const {
+        return nodes.size();
+    }
+
+    DyckCallGraphNode * getNode(unsigned i) {
+        return nodes[i];
+    }
+
+    /// The node of f, or null if f has no node.
+    DyckCallGraphNode * lookupFunction(Function * f) {
+        auto it = nodeIndices.find(f);
+        if (it == nodeIndices.end()) {
+            return NULL;
+        }
+        return nodes[it->second];
     }
 
     DyckCallGraphNode * getOrInsertFunction(Function * f) {
-        DyckCallGraphNode * parent = NULL;
-        if (!FunctionMap.count(f)) {
-            parent = new DyckCallGraphNode(f);
-            FunctionMap.insert(pair<Function*, DyckCallGraphNode *>(f, parent));
-        } else {
-            parent = FunctionMap[f];
+        auto res = nodeIndices.insert(make_pair(f, (unsigned) nodes.size()));
+        if (res.second) {
+            nodes.push_back(new DyckCallGraphNode(f, nodes.size()));
         }
-        return parent;
+        return nodes[res.first->second];
     }
-    
+
+    CommonCall * createCommonCall(Instruction* inst, Function * function, vector<Value*>* args) {
+        return commonCallAllocator.create(inst, function, args);
+    }
+
+    PointerCall * createPointerCall(Instruction* inst, Value * calledValue, vector<Value*>* args) {
+        return pointerCallAllocator.create(inst, calledValue, args);
+    }
+
+    /// Build the edges, the SCCs and the topological order of the current
+    /// graph, with the resolved callees of the pointer calls if pointerCalls
+    /// is true. They are not updated when the graph changes, and do not
+    /// cover the nodes created after it.
+    void build(bool pointerCalls = true);
+
+    /// The indices of the callees/callers of node i.
+    ArrayRef<unsigned> getCallees(unsigned i) const {
+        assert(i + 1 < calleeOffsets.size() && "Error: the node is not in the built graph!");
+        return ArrayRef<unsigned>(callees.data() + calleeOffsets[i], calleeOffsets[i + 1] - calleeOffsets[i]);
+    }
+
+    ArrayRef<unsigned> getCallers(unsigned i) const {
+        assert(i + 1 < callerOffsets.size() && "Error: the node is not in the built graph!");
+        return ArrayRef<unsigned>(callers.data() + callerOffsets[i], callerOffsets[i + 1] - callerOffsets[i]);
+    }
+
+    unsigned getNumSCCs() const {
+        return sccOffsets.empty() ? 0 : sccOffsets.size() - 1;
+    }
+
+    /// The indices of the nodes in SCC k, where callees come first.
+    ArrayRef<unsigned> getSCC(unsigned k) const {
+        return ArrayRef<unsigned>(sccNodes.data() + sccOffsets[k], sccOffsets[k + 1] - sccOffsets[k]);
+    }
+
+    /// The SCC of node i.
+    unsigned getSCCIndex(unsigned i) const {
+        return nodeSCCs[i];
+    }
+
+    /// The indices of the nodes, where callers come first.
+    ArrayRef<unsigned> getTopologicalOrder() const {
+        return topologicalOrder;
+    }
+
     void dotCallGraph(const string& mIdentifier);
     void printFunctionPointersInformation(const string& mIdentifier);
     
@@ -17,6 +17,7 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -52,7 +53,8 @@ public:
 
 class PointerCall : public Call{
 public:
-    set<Function*> mayAliasedCallees;
+    // in the order they are found
+    SetVector<Function*> mayAliasedCallees;
     bool mustAliasedPointerCall;
 
     PointerCall(Instruction* inst, Value* calledValue, vector<Value*>* args);
@@ -71,20 +73,18 @@ private:
     set<Value*> resumes;
     map<Value*, Value*> lpads; // invoke <-> lpad
 
-    // call instructions in the function
-    set<CommonCall *> commonCalls; // common calls
-    set<PointerCall*> pointerCalls; // pointer calls
+    // call instructions in the function, in the order they are added
+    vector<CommonCall *> commonCalls; // common calls
+    vector<PointerCall*> pointerCalls; // pointer calls
     
     map<Instruction*, Call*> instructionCallMap;
     
     set<CallInst*> inlineAsms; // inline asm must be a call inst
 
-private:
-    static int global_idx;
-
 public:
 
-    DyckCallGraphNode(Function *f);
+    /// idx is the position of the node in the call graph.
+    DyckCallGraphNode(Function *f, int idx);
 
     ~DyckCallGraphNode();
 
@@ -92,11 +92,11 @@ public:
 
     Function* getLLVMFunction();
 
-    set<CommonCall *>& getCommonCalls();
+    vector<CommonCall *>& getCommonCalls();
 
     void addCommonCall(CommonCall * call);
 
-    set<PointerCall *>& getPointerCalls();
+    vector<PointerCall *>& getPointerCalls();
 
     void addPointerCall(PointerCall * call);
 
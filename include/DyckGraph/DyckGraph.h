@@ -16,16 +16,24 @@ using namespace std;
 /// See details in http://dl.acm.org/citation.cfm?id=2491956.2462159&coll=DL&dl=ACM&CFID=379446910&CFTOKEN=65130716 .
 class DyckGraph {
 private:
+	/// vertices and their edge sets are released in bulk with the graph
+	SlabAllocator<DyckVertex> vertexAllocator;
+	EdgeSetAllocator edgeSetAllocator;
+
 	set<DyckVertex*> vertices;
 
 	unordered_map<void *, DyckVertex*> val_ver_map;
+
+	/// see freeze()
+	bool frozen;
+	DyckVertex* sentinel;
 public:
-	DyckGraph() {
+	DyckGraph() :
+			frozen(false), sentinel(NULL) {
 	}
 	~DyckGraph() {
-		for (auto& v : vertices) {
-			delete v;
-		}
+		vertexAllocator.reset();
+		edgeSetAllocator.reset();
 	}
 
 	/// The number of vertices in the graph.
@@ -53,16 +61,47 @@ public:
 
 	DyckVertex* findDyckVertex(void* value);
 
+	/// Let a value that does not have a vertex share the vertex ver, e.g.
+	/// the value is known to be equivalent to a value of ver beforehand.
+	DyckVertex* bindDyckVertex(void* value, DyckVertex* ver);
+
+	/// Let a value not have a vertex any more, e.g. it is deleted, so that
+	/// a new value at the same address does not get its vertex. It is also
+	/// allowed after the graph is frozen, but not while it is queried.
+	void unbindDyckVertex(void* value);
+
+	/// After the graph is frozen, it cannot be changed any more, and it can
+	/// be queried by multiple threads. retrieveDyckVertex does not add new
+	/// vertices, but returns a shared sentinel vertex, which has no edges
+	/// and no values, for a value that is not in the graph.
+	void freeze();
+
+	bool isFrozen() {
+		return frozen;
+	}
+
 	/// The algorithm proposed by Qirun Zhang.
 	/// Find the paper here: http://dl.acm.org/citation.cfm?id=2491956.2462159&coll=DL&dl=ACM&CFID=379446910&CFTOKEN=65130716 .
 	/// Note that if there are two edges with the same label: a->b and a->c, b and c will be put into the same equivelant class.
 	/// If the function does nothing, return true, otherwise return false.
 	bool qirunAlgorithm();
 
+	/// The same as qirunAlgorithm(), but only the vertices in seeds are
+	/// checked at first, e.g. those that have got new targets or have been
+	/// combined since the last time, if the others have been checked.
+	bool qirunAlgorithm(const set<DyckVertex*>& seeds);
+
 	/// validation
 	void validation(const char*, int);
 
 private:
+	/// Destroy a vertex that has been combined into another one.
+	void destroyVertex(DyckVertex* v);
+
+	/// Combine the targets of the pairs in the worklist until there are
+	/// not two targets with the same label of a vertex.
+	bool propagate(multimap<DyckVertex*, void*>& worklist);
+
 	void removeFromWorkList(multimap<DyckVertex*, void*>& list, DyckVertex* v, void* l);
 
 	bool containsInWorkList(multimap<DyckVertex*, void*>& list, DyckVertex* v, void* l);
@@ -6,6 +6,8 @@
 #ifndef DYCKVERTEX_H
 #define	DYCKVERTEX_H
 
+#include "DyckGraph/SlabAllocator.h"
+
 #include <map>
 #include <set>
 #include <stdio.h>
@@ -14,6 +16,9 @@
 using namespace std;
 
 class DyckGraph;
+class DyckVertex;
+
+typedef SlabAllocator<set<DyckVertex*> > EdgeSetAllocator;
 /// This class models the vertex in DyckGraph.
 
 class DyckVertex {
@@ -28,6 +33,9 @@ private:
 	map<void*, set<DyckVertex*>*> in_vers;
 	map<void*, set<DyckVertex*>*> out_vers;
 
+	/// the per-label sets above are allocated from the graph's arena
+	EdgeSetAllocator* edge_sets;
+
 	/// only store non-null value
 	set<void*> equivclass;
 
@@ -40,10 +48,11 @@ private:
 	/// You are not recommended to assign names to vertices when you need not to print the graph,
 	/// because it may be time-consuming for you to construct names for vertices.
 	/// please use DyckGraph::retrieveDyckVertex for initialization.
-	DyckVertex(void * v, const char* itsname = NULL);
+	DyckVertex(EdgeSetAllocator* edgesets, void * v, const char* itsname = NULL);
 
 public:
 	friend class DyckGraph;
+	friend class SlabAllocator<DyckVertex>;
 
 public:
 	~DyckVertex();
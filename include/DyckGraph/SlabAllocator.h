@@ -0,0 +1,93 @@
+/*
+ * File:   SlabAllocator.h
+ *
+ * An arena of objects of the same type. Objects are carved out of large
+ * slabs instead of being allocated one by one, and are destroyed and
+ * released all together when the allocator is reset or destroyed. The
+ * memory of an object destroyed earlier is reused by later objects.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef SLABALLOCATOR_H
+#define	SLABALLOCATOR_H
+
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <vector>
+
+template<class T, unsigned SLAB_SIZE = 1024>
+class SlabAllocator {
+private:
+	std::vector<T*> slabs;
+
+	/// number of objects carved out of the last slab
+	unsigned used;
+
+	/// destroyed objects whose memory can be reused
+	std::vector<T*> freed;
+
+public:
+	SlabAllocator() :
+			used(SLAB_SIZE) {
+	}
+
+	~SlabAllocator() {
+		reset();
+	}
+
+	SlabAllocator(const SlabAllocator&) = delete;
+	SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+	template<class ... Args>
+	T* create(Args&&... args) {
+		void* mem;
+		if (!freed.empty()) {
+			mem = freed.back();
+			freed.pop_back();
+		} else {
+			if (used == SLAB_SIZE) {
+				slabs.push_back(static_cast<T*>(::operator new(sizeof(T) * SLAB_SIZE)));
+				used = 0;
+			}
+			mem = slabs.back() + used++;
+		}
+		return new (mem) T(std::forward<Args>(args)...);
+	}
+
+	/// Destroy an object now. Its memory is kept for later objects.
+	void destroy(T* obj) {
+		obj->~T();
+		freed.push_back(obj);
+	}
+
+	/// The number of live objects.
+	size_t size() const {
+		if (slabs.empty()) {
+			return 0;
+		}
+		return (slabs.size() - 1) * SLAB_SIZE + used - freed.size();
+	}
+
+	/// Destroy all the live objects and release all the slabs.
+	void reset() {
+		std::sort(freed.begin(), freed.end());
+		for (size_t i = 0; i < slabs.size(); i++) {
+			unsigned num = i + 1 == slabs.size() ? used : SLAB_SIZE;
+			for (unsigned j = 0; j < num; j++) {
+				T* obj = slabs[i] + j;
+				if (!std::binary_search(freed.begin(), freed.end(), obj)) {
+					obj->~T();
+				}
+			}
+			::operator delete(slabs[i]);
+		}
+		slabs.clear();
+		freed.clear();
+		used = SLAB_SIZE;
+	}
+};
+
+#endif	/* SLABALLOCATOR_H */
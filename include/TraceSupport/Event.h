@@ -21,8 +21,7 @@ typedef struct Event {
     long mem;
     int type;
     long line;
-    int * locks;
-    int lock_num;
+    int lockset; // id of the held lockset, interned by pecan
     pthread_t synctid;
     pthread_cond_t * cond;
     char srcfile[100];
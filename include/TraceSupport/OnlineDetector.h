@@ -0,0 +1,107 @@
+/*
+ * File:   OnlineDetector.h
+ *
+ * An online data race detector for the trace runtime. It maintains vector
+ * clocks for threads, locks and condition variables, and FastTrack-style
+ * epochs for every accessed address, so that races can be reported while
+ * the program runs instead of dumping a trace for pecan.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef ONLINEDETECTOR_H
+#define	ONLINEDETECTOR_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+class OnlineDetector {
+public:
+    typedef vector<unsigned> VectorClock;
+
+    /// An epoch c@t: the clock c of the thread t.
+    struct Epoch {
+        int tid;
+        unsigned clock;
+    };
+
+    /// Where an access happens, used for reporting.
+    struct Site {
+        const char * file;
+        long line;
+    };
+
+    /// Shadow state of an address. If the reads are not totally ordered,
+    /// read_vc is used instead of the read epoch (read.tid == SHARED).
+    struct Shadow {
+        Epoch write;
+        Site write_site;
+
+        Epoch read;
+        Site read_site;
+        VectorClock read_vc;
+        vector<Site> read_vc_sites;
+    };
+
+private:
+    pthread_mutex_t mutex;
+
+    unordered_map<pthread_t, int> thread_ids;
+    vector<VectorClock> thread_vcs;
+
+    unordered_map<long, VectorClock> lock_vcs;
+    unordered_map<long, VectorClock> cond_vcs;
+    unordered_map<pthread_t, VectorClock> forked_vcs; // forked but not started
+
+    unordered_map<long, Shadow> shadows;
+
+    set<pair<string, string> > reported;
+    unsigned long race_num;
+    FILE* fout;
+
+public:
+    OnlineDetector();
+    ~OnlineDetector();
+
+    /// Races are reported into the file.
+    void init(const char* filename);
+
+    /// Print the summary and close the report file.
+    void finish();
+
+    void onRead(pthread_t t, long mem, const char * file, long line);
+    void onWrite(pthread_t t, long mem, const char * file, long line);
+
+    void onAcquire(pthread_t t, long lock);
+    void onRelease(pthread_t t, long lock);
+
+    void onFork(pthread_t t, pthread_t child);
+    void onJoin(pthread_t t, pthread_t child);
+
+    void onWait(pthread_t t, long cond, long lock);
+    void onNotify(pthread_t t, long cond);
+
+private:
+    int getThreadId(pthread_t t);
+
+    Epoch epoch(int tid);
+
+    /// e <= vc
+    static bool happensBefore(const Epoch& e, const VectorClock& vc);
+
+    /// to = to join from
+    static void join(VectorClock& to, const VectorClock& from);
+
+    void report(const char* kind, long mem, const Site& prev, const Site& cur);
+};
+
+#endif	/* ONLINEDETECTOR_H */
@@ -31,13 +31,14 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <unordered_map>
 
 using namespace std;
 using namespace llvm;
 
 class Transformer  {
 public:
-    void transform(Module* module, AliasAnalysis* AAptr);
+    void transform(Module* module, DyckAliasAnalysis& AA);
 
     /// the var agrs are the arguments of the call inst.
     /// the last one must be NULL, otherwise the behavior is not defined.
@@ -46,6 +47,10 @@ public:
     CallInst* insertCallInstAtHead(Function* theFunc, Function * tocall, ...);
     CallInst* insertCallInstAtTail(Function* theFunc, Function * tocall, ...);
 
+    /// A masked load or store, gather or scatter, i.e. load/gather(ptr,
+    /// align, mask, passthru) or store/scatter(value, ptr, align, mask).
+    static bool isMaskedVectorAccess(CallInst* call);
+
 public:
 
     virtual ~Transformer() {
@@ -117,6 +122,10 @@ public:
     virtual void transformOtherIntrinsics(Module* module, CallInst* ins, AliasAnalysis& AA) {
     }
 
+    /// Masked loads and stores, gathers and scatters.
+    virtual void transformMaskedVectorAccess(Module* module, CallInst* ins, AliasAnalysis& AA) {
+    }
+
     virtual void transformAddressInit(Module* module, CallInst* ins, AliasAnalysis& AA) {
     }
 
@@ -139,7 +148,19 @@ public:
         return false;
     }
 
+protected:
+    /// The index of the shared variable v points to, -1 if none. The
+    /// indices are cached, so computeValueIndex is called once per value.
+    int getValueIndex(Module* module, Value * v, AliasAnalysis& AA);
+
+    virtual int computeValueIndex(Value * v) {
+        return -1;
+    }
+
 private:
+    // indices of values
+    unordered_map<Value*, int> valueIndexCache;
+
     // all calls have been lowered to invokes
     bool handleCalls(Module* module, CallInst * call, Function* calledFunction, AliasAnalysis& AA);
 };
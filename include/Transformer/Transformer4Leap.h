@@ -56,13 +56,14 @@ public:
     virtual void transformMemCpyMov(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual void transformMemSet(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual void transformOtherFunctionCalls(Module* module, CallInst* ins, AliasAnalysis& AA);
+    virtual void transformMaskedVectorAccess(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual bool isInstrumentationFunction(Module* module, Function *f);
 
     virtual bool debug();
 
 private:
 
-    int getValueIndex(Module* module, Value * v, AliasAnalysis& AA);
+    virtual int computeValueIndex(Value * v);
 
 };
 
@@ -20,13 +20,40 @@ private:
     Function *F_prefork, *F_fork, *F_prejoin, *F_join;
     Function *F_prewait, *F_wait, *F_prenotify, *F_notify;
     Function *F_init, *F_exit/*, *F_thread_init, *F_thread_exit*/;
+    Function *F_accesses;
 
-    set<Function*> ignored_funcs;
+    // the static filter of accesses, see filterAccesses
+    bool filtering;
+    set<Function*> concurrent_funcs; // may run in parallel with other threads
+    set<BasicBlock*> parallel_blocks; // parallel parts of the other functions
+    set<int> written_vars; // shared variables written in parallel code
+    set<Function*> unlisted_funcs; // excluded by -trace-allow and -trace-deny
+    // instructions with a filtered access, which may be visited more than
+    // once, e.g. memcpy for the source and destination, or a pointer call
+    // for each callee
+    set<Instruction*> filtered_insts;
 
 private:
     size_t ptrsize; // = sizeof(int*)
     std::vector<const set<Value*>*> sharedVariables;
 
+    // every instrumented access site has an id, used by the runtime to
+    // sample the accesses of each site separately
+    int site_num;
+
+    // the accesses of a straight-line run in a block, which are recorded
+    // by one OnAccesses after the last of them, see flushBatch
+    struct BatchedAccess {
+        Instruction* inst;
+        Value* mem;
+        Value* line;
+        Value* site;
+        bool write;
+    };
+    vector<BatchedAccess> batch;
+    map<Function*, AllocaInst*> batchBuffers; // addresses of a batch
+    unsigned long batch_num;
+
 public:
     static char ID;
 
@@ -57,15 +84,29 @@ public:
     virtual void transformMemCpyMov(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual void transformMemSet(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual void transformOtherFunctionCalls(Module* module, CallInst* ins, AliasAnalysis& AA);
+    virtual void transformMaskedVectorAccess(Module* module, CallInst* ins, AliasAnalysis& AA);
     virtual bool isInstrumentationFunction(Module* module, Function *f);
 
     virtual bool debug();
 
 private:
-    int getValueIndex(Module* module, Value * v, AliasAnalysis& AA);
+    virtual int computeValueIndex(Value * v);
+
+    /// Accesses that cannot be racy are filtered out, i.e. those in the code
+    /// only executed before the first fork or after joining the only forked
+    /// thread, and the reads of shared variables that are never written in
+    /// parallel code.
+    void filterAccesses(Module* module, DyckAliasAnalysis& AA);
+    bool accessToTransform(Instruction* inst, int svIdx, bool write);
 
     Value* getOrInsertSrcFileNameValue(Module* module, Instruction* inst);
     Value* getOtInsertLineNumberValue(Module* module, Instruction * inst);
+    Value* getNewSiteValue(Module* module);
+
+    void batchAccess(Module* module, Instruction* inst, Value* mem, Value* line, Value* site, bool write);
+    void batchVectorAccess(Module* module, Instruction* inst, Value* ptr, Value* mask, Value* line, Value* site, bool write);
+    bool isBatchBarrier(Instruction* inst);
+    void flushBatch(Module* module);
 };
 
 #endif	/* TRANSFORMER4TRACE_H */
@@ -0,0 +1,259 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "Devirt/SpeculativeDevirt.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+
+#include <algorithm>
+
+static cl::opt<unsigned> DevirtMaxTargets("devirt-max-targets", cl::init(2), cl::Hidden,
+        cl::desc("Devirtualize the pointer calls that may call at most this number of functions."));
+
+SpeculativeDevirt::SpeculativeDevirt() : ModulePass(ID), guarded_num(0), direct_num(0) {
+    // the pass is created before the alias analysis runs
+    DyckAliasAnalysis::preserveCallGraph();
+}
+
+void SpeculativeDevirt::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<DyckAliasAnalysis>();
+    // nothing is preserved: the calls are rewritten, and the maps of the
+    // alias analysis, e.g. its call graph, do not know the new code, so it
+    // is run again if a later pass requires it
+}
+
+RegisterPass<SpeculativeDevirt> D("dyckdevirt", "Rewrite resolved pointer calls into guarded direct calls.");
+
+// Register this pass...
+char SpeculativeDevirt::ID = 0;
+
+static const Attribute::AttrKind ABIAttributes[] = {
+    Attribute::ByVal, Attribute::StructRet, Attribute::InAlloca, Attribute::InReg, Attribute::Nest
+};
+
+/// Whether the parameter at the index has the same attributes that change
+/// how it is passed in both sets, and whether it has any of them.
+static bool sameABIAttributes(AttributeSet a, AttributeSet b, unsigned index, bool& has) {
+    has = false;
+    for (auto kind : ABIAttributes) {
+        if (a.hasAttribute(index, kind) != b.hasAttribute(index, kind)) {
+            return false;
+        }
+        has |= a.hasAttribute(index, kind);
+    }
+    return true;
+}
+
+/// Whether the call can call the function directly, with the arguments and
+/// the return value bitcast if needed. An argument passed e.g. byval must
+/// be passed in the same way, and without a cast, since the pointee type
+/// decides the ABI.
+static bool isCompatible(CallInst* call, Function* f) {
+    FunctionType* fty = f->getFunctionType();
+    unsigned num = call->getNumArgOperands();
+    if (fty->getNumParams() > num || (!fty->isVarArg() && fty->getNumParams() != num)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < fty->getNumParams(); i++) {
+        Type* argTy = call->getArgOperand(i)->getType();
+        if (argTy != fty->getParamType(i) && !CastInst::isBitCastable(argTy, fty->getParamType(i))) {
+            return false;
+        }
+
+        bool abi;
+        if (!sameABIAttributes(call->getAttributes(), f->getAttributes(), i + 1, abi)) {
+            return false;
+        }
+        if (abi && argTy != fty->getParamType(i)) {
+            return false;
+        }
+    }
+
+    Type* retTy = call->getType();
+    return retTy->isVoidTy() || retTy == fty->getReturnType() || CastInst::isBitCastable(fty->getReturnType(), retTy);
+}
+
+/// Add the attributes at the index of the set into attrs, if any.
+static void copyAttributes(LLVMContext& context, AttributeSet from, unsigned index, SmallVectorImpl<AttributeSet>& attrs) {
+    if (from.hasAttributes(index)) {
+        AttrBuilder builder(from, index);
+        attrs.push_back(AttributeSet::get(context, index, builder));
+    }
+}
+
+/// Insert a direct call to f with the arguments of the call, and return
+/// the value to replace the result of the call.
+static Value* createDirectCall(CallInst* call, Function* f, Instruction* insertBefore) {
+    FunctionType* fty = f->getFunctionType();
+    LLVMContext& context = call->getContext();
+    AttributeSet callAttrs = call->getAttributes();
+
+    // the attributes are copied per argument, except those of the casted
+    // arguments and return value, which may not fit the new types; the
+    // ABI attributes are never on casted ones, see isCompatible
+    SmallVector<AttributeSet, 8> attrs;
+    if (call->getType() == fty->getReturnType()) {
+        copyAttributes(context, callAttrs, AttributeSet::ReturnIndex, attrs);
+    }
+
+    vector<Value*> args;
+    for (unsigned i = 0; i < call->getNumArgOperands(); i++) {
+        Value* arg = call->getArgOperand(i);
+        if (i < fty->getNumParams() && arg->getType() != fty->getParamType(i)) {
+            arg = new BitCastInst(arg, fty->getParamType(i), "", insertBefore);
+        } else {
+            copyAttributes(context, callAttrs, i + 1, attrs);
+        }
+        args.push_back(arg);
+    }
+
+    copyAttributes(context, callAttrs, AttributeSet::FunctionIndex, attrs);
+
+    CallInst* direct = CallInst::Create(f, args, "", insertBefore);
+    direct->setCallingConv(f->getCallingConv());
+    direct->setTailCall(call->isTailCall());
+    direct->setDebugLoc(call->getDebugLoc());
+    direct->setAttributes(AttributeSet::get(context, attrs));
+
+    if (call->getType()->isVoidTy() || call->getType() == direct->getType()) {
+        return direct;
+    }
+    return new BitCastInst(direct, call->getType(), "", insertBefore);
+}
+
+bool SpeculativeDevirt::runOnModule(Module & M) {
+    DyckAliasAnalysis& AA = this->getAnalysis<DyckAliasAnalysis>();
+    assert(AA.callGraphPreserved() && "Error: the call graph is not preserved for devirtualization!");
+
+    DyckCallGraph* cg = AA.getCallGraph();
+
+    // the calls are collected in the order of the module first, since the
+    // rewriting splits the blocks
+    struct Site {
+        CallInst* call;
+        vector<Function*> targets;
+        bool must;
+    };
+    vector<Site> sites;
+    for (auto fit = M.begin(); fit != M.end(); ++fit) {
+        Function* f = &*fit;
+        DyckCallGraphNode* node = cg->lookupFunction(f);
+        if (node == NULL) {
+            continue;
+        }
+
+        for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+            CallInst* call = dyn_cast<CallInst>(&*it);
+            if (call == NULL || call->isMustTailCall() || call->isInlineAsm()) {
+                continue;
+            }
+
+            Call* c = node->getCall(call);
+            if (c == NULL || isa<Function>(c->calledValue)) {
+                continue;
+            }
+
+            PointerCall* pc = (PointerCall*) c;
+            if (pc->mayAliasedCallees.empty() || pc->mayAliasedCallees.size() > DevirtMaxTargets) {
+                continue;
+            }
+
+            // targets that cannot be called directly are left to the fallback
+            vector<Function*> targets;
+            for (auto callee : pc->mayAliasedCallees) {
+                if (isCompatible(call, callee)) {
+                    targets.push_back(callee);
+                }
+            }
+            if (targets.empty()) {
+                continue;
+            }
+            sort(targets.begin(), targets.end(), [](Function* a, Function* b) {
+                return a->getName() < b->getName();
+            });
+
+            // the called value of a must-aliased one is the function via
+            // casts or aliases
+            Site site = { call, targets, pc->mustAliasedPointerCall };
+            sites.push_back(site);
+        }
+    }
+
+    for (auto& site : sites) {
+        if (site.must) {
+            this->callDirectly(site.call, site.targets.front());
+        } else {
+            this->devirtualize(site.call, site.targets);
+        }
+    }
+
+    outs() << "# devirtualized pointer calls: " << guarded_num << " guarded, " << direct_num << " direct\n";
+    return !sites.empty();
+}
+
+void SpeculativeDevirt::devirtualize(CallInst* call, const vector<Function*>& targets) {
+    Value* fp = call->getCalledValue();
+    BasicBlock* head = call->getParent();
+    Function* parent = head->getParent();
+    LLVMContext& context = call->getContext();
+
+    // head: ... ; the checks ; devirt.indirect: the pointer call ; devirt.end: ...
+    BasicBlock* tail = head->splitBasicBlock(call, "devirt.end");
+    head->getTerminator()->eraseFromParent();
+
+    BasicBlock* indirect = BasicBlock::Create(context, "devirt.indirect", parent, tail);
+    call->removeFromParent();
+    indirect->getInstList().push_back(call);
+    BranchInst::Create(tail, indirect);
+
+    PHINode* phi = NULL;
+    if (!call->getType()->isVoidTy()) {
+        phi = PHINode::Create(call->getType(), targets.size() + 1, "devirt.ret", &tail->front());
+        call->replaceAllUsesWith(phi);
+    }
+
+    BasicBlock* check = head;
+    for (unsigned i = 0; i < targets.size(); i++) {
+        BasicBlock* direct = BasicBlock::Create(context, "devirt.direct", parent, indirect);
+        BasicBlock* next = indirect;
+        if (i + 1 < targets.size()) {
+            next = BasicBlock::Create(context, "devirt.check", parent, indirect);
+        }
+
+        Constant* target = ConstantExpr::getBitCast(targets[i], fp->getType());
+        ICmpInst* cmp = new ICmpInst(*check, ICmpInst::ICMP_EQ, fp, target, "devirt.cmp");
+        BranchInst::Create(direct, next, cmp, check);
+
+        BranchInst* br = BranchInst::Create(tail, direct);
+        Value* ret = createDirectCall(call, targets[i], br);
+        if (phi != NULL) {
+            phi->addIncoming(ret, direct);
+        }
+        check = next;
+    }
+
+    if (phi != NULL) {
+        phi->addIncoming(call, indirect);
+    }
+    guarded_num++;
+}
+
+void SpeculativeDevirt::callDirectly(CallInst* call, Function* callee) {
+    Value* ret = createDirectCall(call, callee, call);
+    if (!call->getType()->isVoidTy()) {
+        call->replaceAllUsesWith(ret);
+    }
+    call->eraseFromParent();
+    direct_num++;
+}
+
+ModulePass *createSpeculativeDevirtPass() {
+    return new SpeculativeDevirt();
+}
@@ -5,6 +5,11 @@
 
 #define DEBUG_TYPE "dyckaa"
 #include "DyckAA/AAAnalyzer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/IR/InstIterator.h"
+
+#include <functional>
 
 static cl::opt<bool> NoFunctionTypeCheck("no-function-type-check", cl::init(false), cl::Hidden,
 		cl::desc("Do not check function type when resolving pointer calls."));
@@ -15,11 +20,28 @@ static cl::opt<bool> WithFunctionCastComb("with-function-cast-comb", cl::init(fa
 static cl::opt<unsigned> NumInterIteration("dyckaa-inter-iteration", cl::init(UINT_MAX), cl::Hidden,
         cl::desc("The max number of iterators for fix-pointer computation during interprocedure analysis."));
 
-AAAnalyzer::AAAnalyzer(Module* m, DyckAliasAnalysis* a, DyckGraph* d, DyckCallGraph* cg) {
+static cl::opt<bool> NoValueNumbering("dyckaa-no-value-numbering", cl::init(false), cl::Hidden,
+		cl::desc("Do not find pointer-equivalent values before the analysis."));
+
+static cl::opt<std::string> SummaryCacheDir("dyckaa-summary-cache", cl::init(""), cl::Hidden,
+		cl::desc("A directory to save the summaries of functions in, and to reuse them for unchanged functions."));
+
+/// The options that change the ops recorded in a summary, e.g. a GEP of a
+/// numbered value is only wrapped, so they are in the hash of the summary.
+static uint64_t summaryOptions() {
+	uint64_t options = (NoValueNumbering ? 1 : 0) | (NoFunctionTypeCheck ? 2 : 0) | (WithFunctionCastComb ? 4 : 0);
+	return options * 0x9e3779b97f4a7c15ULL;
+}
+
+AAAnalyzer::AAAnalyzer(Module* m, DyckAliasAnalysis* a, DyckGraph* d, DyckCallGraph* cg, bool demand) {
 	module = m;
 	aa = a;
 	dgraph = d;
 	callgraph = cg;
+	demandDriven = demand;
+	summary = NULL;
+	summaryDepth = 0;
+	touchedVertices = NULL;
 }
 
 AAAnalyzer::~AAAnalyzer() {
@@ -28,6 +50,16 @@ AAAnalyzer::~AAAnalyzer() {
 
 void AAAnalyzer::start_intra_procedure_analysis() {
 	this->initFunctionGroups();
+
+	if (!NoValueNumbering) {
+		this->number_values();
+	}
+
+	if (!SummaryCacheDir.empty()) {
+		if (sys::fs::create_directories(SummaryCacheDir.getValue())) {
+			errs() << "WARNING: cannot create " << SummaryCacheDir << ", summaries are not saved.\n";
+		}
+	}
 }
 
 void AAAnalyzer::end_intra_procedure_analysis() {
@@ -43,6 +75,17 @@ void AAAnalyzer::end_inter_procedure_analysis() {
 void AAAnalyzer::intra_procedure_analysis() {
 	long instNum = 0;
 	long intrinsicsNum = 0;
+	long reusedNum = 0;
+	long savedNum = 0;
+
+	// the nodes are created in the order of the module first, since a
+	// function may get its node when it is called, e.g. pthread_create
+	for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
+		if (!iterF->isIntrinsic()) {
+			callgraph->getOrInsertFunction(iterF);
+		}
+	}
+
 	for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
 		Function* f = iterF;
 		if (f->isIntrinsic()) {
@@ -51,77 +94,130 @@ void AAAnalyzer::intra_procedure_analysis() {
 			continue;
 		}
 		DyckCallGraphNode* df = callgraph->getOrInsertFunction(f);
+
+		// reuse the summary of the function if it is not changed
+		FunctionSummary* fs = NULL;
+		std::string summaryFile;
+		if (!SummaryCacheDir.empty() && !f->empty()) {
+			// library calls are summarized by the specs, so they are in the hash
+			// too, and so are the options of the analysis
+			uint64_t hash = FunctionSummary::hash(f) ^ aa->getLibrarySpec()->fingerprint() ^ summaryOptions();
+			std::string hashStr;
+			raw_string_ostream(hashStr) << format("%016llx", (unsigned long long) hash);
+			summaryFile = SummaryCacheDir + "/" + hashStr + ".dyck";
+
+			fs = new FunctionSummary(f);
+			if (fs->load(summaryFile)) {
+				DEBUG_WITH_TYPE("summary", errs() << "Reuse the summary of " << f->getName() << "\n");
+				this->replay_summary(fs, df);
+				for (ilist_iterator<BasicBlock> iterB = f->getBasicBlockList().begin(); iterB != f->getBasicBlockList().end(); iterB++) {
+					instNum += iterB->size();
+				}
+				reusedNum++;
+				delete fs;
+				continue;
+			}
+			summary = fs;
+		}
+
 		for (ilist_iterator<BasicBlock> iterB = f->getBasicBlockList().begin(); iterB != f->getBasicBlockList().end(); iterB++) {
 			for (ilist_iterator<Instruction> iterI = iterB->getInstList().begin(); iterI != iterB->getInstList().end(); iterI++) {
 				Instruction *inst = iterI;
 				instNum++;
 
 				DEBUG_WITH_TYPE("inst", errs() << *inst << "\n");
+				if (summary) {
+					summary->setCurrentInstruction(inst);
+				}
 				handle_inst(inst, df);
 			}
 		}
+
+		if (fs) {
+			if (fs->isValid() && fs->save(summaryFile)) {
+				savedNum++;
+			}
+			summary = NULL;
+			delete fs;
+		}
 	}
 	outs() << "# Instructions: " << instNum << "\n";
 	outs() << "# Functions: " << module->getFunctionList().size() - intrinsicsNum << "\n";
+
+	unsigned long edgeNum = 0;
+	for (auto v : dgraph->getVertices()) {
+		for (auto& it : v->getOutVertices()) {
+			edgeNum += it.second->size();
+		}
+	}
+	outs() << "# Vertices: " << dgraph->numVertices() << ", Edges: " << edgeNum << "\n";
+	if (!SummaryCacheDir.empty()) {
+		outs() << "# Summaries: " << reusedNum << " reused, " << savedNum << " saved\n";
+	}
 	return;
 }
 
 void AAAnalyzer::inter_procedure_analysis() {
-	map<DyckCallGraphNode*, set<CommonCall*>> handledCommonCalls;
-
 	unsigned NumIteration = 0;
 	while (1) {
         if (NumIteration++ >= NumInterIteration.getValue()) {
             break;
         }
 
-		outs() << "\nIteration #" << NumIteration << "... \n";
+		// the demand-driven mode runs once per query that demands new vertices
+		if (!demandDriven) {
+			outs() << "\nIteration #" << NumIteration << "... \n";
+		}
 
 		bool finished = true;
 		dgraph->qirunAlgorithm();
+		this->bucketFunctionGroups();
+		if (demandDriven) {
+			this->compute_demanded_vertices();
+		}
 
-		{ // direct calls
-			outs() << "Handling direct calls...";
-			outs().flush();
-			auto dfit = callgraph->begin();
-			while (dfit != callgraph->end()) {
-				DyckCallGraphNode * df = dfit->second;
-				set<CommonCall*>& df_handledCommonCalls = handledCommonCalls[df];
-				set<CommonCall*>& df_commonCalls = df->getCommonCalls();
-
-				// df_unHandledCommonCalls = df_commonCalls - df_handledCommonCalls
-				set<CommonCall*> df_unHandledCommonCalls;
-				set_difference(df_commonCalls.begin(), df_commonCalls.end(), df_handledCommonCalls.begin(), df_handledCommonCalls.end(),
-						inserter(df_unHandledCommonCalls, df_unHandledCommonCalls.begin()));
-
-				auto cit = df_unHandledCommonCalls.begin();
-				while (cit != df_unHandledCommonCalls.end()) {
-					finished = false;
-					CommonCall * theComCall = *cit;
-					df_handledCommonCalls.insert(theComCall);
+		{ // direct calls, bottom-up over the SCCs of the call graph
+			if (!demandDriven) {
+				outs() << "Handling direct calls...";
+				outs().flush();
+			}
+			callgraph->build(false);
+			for (unsigned k = 0; k < callgraph->getNumSCCs(); k++) {
+				// the functions of an SCC are handled together, and then the
+				// vertices changed are unified before the callers are handled
+				set<DyckVertex*> touched;
+				touchedVertices = &touched;
+				for (auto i : callgraph->getSCC(k)) {
+					if (handle_common_function_calls(callgraph->getNode(i))) {
+						finished = false;
+					}
+				}
+				touchedVertices = NULL;
 
-					Value * cv = theComCall->calledValue;
-					assert(isa<Function>(cv) && "Error: it is not a function in common calls!");
-					handle_common_function_call(theComCall, df, callgraph->getOrInsertFunction((Function*) cv));
-					cit++;
+				if (!touched.empty()) {
+					dgraph->qirunAlgorithm(touched);
 				}
-				// ---------------------------------------------------
-				++dfit;
 			}
-			outs() << "Done!\n";
+			if (!demandDriven) {
+				outs() << "Done!\n";
+			}
 		}
 
 		{ // indirect call
-			int FUNCTION_COUNT = 0;
-			auto dfit = callgraph->begin();
-			while (dfit != callgraph->end()) {
-				DyckCallGraphNode * df = dfit->second;
+			unsigned long PTCALL_TOTAL = 0;
+			for (auto df : *callgraph) {
+				PTCALL_TOTAL += df->getPointerCalls().size();
+			}
+
+			Progress progress("Handling indirect calls", PTCALL_TOTAL);
+			for (unsigned i = 0; i < callgraph->size(); i++) {
+				DyckCallGraphNode * df = callgraph->getNode(i);
 
-				if (handle_pointer_function_calls(df, ++FUNCTION_COUNT)) {
+				if (handle_pointer_function_calls(df, progress)) {
 					finished = false;
 				}
-				++dfit;
 			}
+			progress.finish();
 		}
 
 		if (finished) {
@@ -132,14 +228,322 @@ void AAAnalyzer::inter_procedure_analysis() {
 	return;
 }
 
+bool AAAnalyzer::handle_common_function_calls(DyckCallGraphNode* df) {
+	bool ret = false;
+	set<CommonCall*>& df_handledCommonCalls = handledCommonCalls[df];
+	vector<CommonCall*>& df_commonCalls = df->getCommonCalls();
+
+	// the calls added while handling them are left to the next iteration
+	unsigned df_callNum = df_commonCalls.size();
+	for (unsigned i = 0; i < df_callNum; i++) {
+		CommonCall * theComCall = df_commonCalls[i];
+		if (df_handledCommonCalls.count(theComCall)) {
+			continue;
+		}
+
+		Value * cv = theComCall->calledValue;
+		assert(isa<Function>(cv) && "Error: it is not a function in common calls!");
+
+		// the call is left until it may change the demanded vertices
+		if (!this->isDemanded(theComCall, (Function*) cv)) {
+			continue;
+		}
+
+		ret = true;
+		df_handledCommonCalls.insert(theComCall);
+
+		handle_common_function_call(theComCall, df, callgraph->getOrInsertFunction((Function*) cv));
+	}
+	return ret;
+}
+
+bool AAAnalyzer::demand_inter_procedure_analysis(set<Value*>* values) {
+	if (!demandDriven) {
+		return false;
+	}
+
+	if (values == NULL) {
+		demandDriven = false;
+		demandedValues.clear();
+		demandedTargets.clear();
+		demandedVertices.clear();
+		demandedFuncs.clear();
+		this->inter_procedure_analysis();
+		return true;
+	}
+
+	// the graph is not changed since the last fixpoint, so the calls that
+	// may change a value reached from the demanded ones have been handled
+	bool grown = false;
+	for (auto& v : *values) {
+		DyckVertex* rep = dgraph->findDyckVertex(v);
+		if (rep != NULL && !demandedTargets.count(rep)) {
+			demandedValues.insert(v);
+			grown = true;
+		}
+	}
+
+	if (!grown) {
+		return false;
+	}
+
+	this->inter_procedure_analysis();
+	return true;
+}
+
+void AAAnalyzer::compute_demanded_vertices() {
+	demandedTargets.clear();
+	demandedVertices.clear();
+	demandedFuncs.clear();
+
+	vector<DyckVertex*> worklist;
+	for (auto& v : demandedValues) {
+		DyckVertex* rep = dgraph->findDyckVertex(v);
+		if (rep != NULL) {
+			worklist.push_back(rep);
+		}
+	}
+	while (!worklist.empty()) {
+		DyckVertex* dv = worklist.back();
+		worklist.pop_back();
+		if (!demandedTargets.insert(dv).second) {
+			continue;
+		}
+
+		for (auto& it : dv->getOutVertices()) {
+			worklist.insert(worklist.end(), it.second->begin(), it.second->end());
+		}
+	}
+
+	// a vertex out of the set only reaches vertices out of it, so combining
+	// two of them combines no vertex in it
+	worklist.assign(demandedTargets.begin(), demandedTargets.end());
+	while (!worklist.empty()) {
+		DyckVertex* dv = worklist.back();
+		worklist.pop_back();
+		if (!demandedVertices.insert(dv).second) {
+			continue;
+		}
+
+		for (auto& it : dv->getInVertices()) {
+			worklist.insert(worklist.end(), it.second->begin(), it.second->end());
+		}
+	}
+
+	for (auto df : *callgraph) {
+		Function* f = df->getLLVMFunction();
+		bool demanded = false;
+		for (auto pit = f->arg_begin(); pit != f->arg_end() && !demanded; ++pit) {
+			demanded = this->isDemanded(&*pit);
+		}
+		for (auto rit = df->getReturns().begin(); rit != df->getReturns().end() && !demanded; ++rit) {
+			demanded = this->isDemanded(*rit);
+		}
+		for (auto vit = df->getVAArgs().begin(); vit != df->getVAArgs().end() && !demanded; ++vit) {
+			demanded = this->isDemanded(*vit);
+		}
+
+		if (demanded) {
+			demandedFuncs.insert(f);
+		}
+	}
+}
+
+bool AAAnalyzer::isDemanded(Call* c, Function* callee) {
+	if (!demandDriven) {
+		return true;
+	}
+
+	if (c->instruction != NULL && this->isDemanded(c->instruction)) {
+		return true;
+	}
+	for (auto& arg : c->args) {
+		if (this->isDemanded(arg)) {
+			return true;
+		}
+	}
+	return callee != NULL && demandedFuncs.count(callee);
+}
+
+bool AAAnalyzer::isDemanded(PointerCall* c, FunctionType* fty) {
+	if (this->isDemanded((Call*) c, NULL)) {
+		return true;
+	}
+
+	// the functions that may be called are of compatible types, which are
+	// all in the group of the type, combined by casts too
+	set<Function*>& compatibleFuncs = this->initFunctionGroup(fty)->compatibleFuncs;
+	for (auto& f : demandedFuncs) {
+		if (compatibleFuncs.count(f)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// The types indexed by the indices of a GEP, the same as gep_type_iterator
+/// except that a GEP of a vector of pointers is walked as a GEP of one of
+/// the pointers, i.e. the vector is not indexed.
+static void getGEPIndexedTypes(GEPOperator* gep, vector<Type*>& types) {
+	Type* ty = gep->getPointerOperandType()->getScalarType();
+	for (unsigned i = 1; i < gep->getNumOperands(); i++) {
+		types.push_back(ty);
+		if (CompositeType* ct = dyn_cast_or_null<CompositeType>(ty)) {
+			ty = ct->getTypeAtIndex(gep->getOperand(i));
+		} else {
+			ty = NULL;
+		}
+	}
+}
+
+namespace {
+struct PointerVectorHash {
+	size_t operator()(const vector<void*>& ps) const {
+		size_t h = 0;
+		for (auto p : ps) {
+			h = h * 31 + std::hash<void*>()(p);
+		}
+		return h;
+	}
+};
+}
+
+void AAAnalyzer::number_values() {
+	unordered_map<Value*, Value*> leaders;
+	auto find = [&](Value* v) {
+		Value* r = v;
+		auto it = leaders.find(r);
+		while (it != leaders.end()) {
+			r = it->second;
+			it = leaders.find(r);
+		}
+		// path compression
+		while (v != r) {
+			Value*& next = leaders[v];
+			v = next;
+			next = r;
+		}
+		return r;
+	};
+
+	// constant casts, e.g. bitcast (@f to i8*), are equivalent to their operands
+	std::function<void(Value*)> numberConstant = [&](Value* v) {
+		ConstantExpr* ce = dyn_cast<ConstantExpr>(v);
+		if (ce == NULL || !ce->isCast() || leaders.count(ce)) {
+			return;
+		}
+		numberConstant(ce->getOperand(0));
+		leaders[ce] = find(ce->getOperand(0));
+	};
+
+	unsigned long valueNum = 0;
+	unsigned long gepNum = 0;
+	for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
+		Function* f = iterF;
+		if (f->isIntrinsic()) {
+			continue;
+		}
+
+		// a PHI may use the values after it, so do it until nothing changes
+		unordered_map<vector<void*>, Value*, PointerVectorHash> geps;
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+				Instruction* inst = &*it;
+				for (unsigned i = 0; i < inst->getNumOperands(); i++) {
+					numberConstant(inst->getOperand(i));
+				}
+				if (leaders.count(inst)) {
+					continue;
+				}
+
+				Value* leader = NULL;
+				if (isa<CastInst>(inst)) {
+					leader = find(inst->getOperand(0));
+				} else if (isa<PHINode>(inst)) {
+					// all the incoming values are equivalent
+					PHINode* phi = (PHINode*) inst;
+					for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+						Value* in = find(phi->getIncomingValue(i));
+						if (in == inst) {
+							continue;
+						} else if (leader == NULL) {
+							leader = in;
+						} else if (leader != in) {
+							leader = NULL;
+							break;
+						}
+					}
+				} else if (isa<SelectInst>(inst)) {
+					Value* t = find(((SelectInst*) inst)->getTrueValue());
+					Value* e = find(((SelectInst*) inst)->getFalseValue());
+					if (t == e) {
+						leader = t;
+					}
+				} else if (isa<GetElementPtrInst>(inst)) {
+					// the same as handle_gep, a GEP without struct indices is
+					// an alias of its pointer operand
+					GEPOperator* gep = (GEPOperator*) inst;
+					vector<void*> key;
+					key.push_back(gep->getPointerOperandType());
+					key.push_back(find(gep->getPointerOperand()));
+
+					bool structIdx = false, unknownTy = false;
+					vector<Type*> indexedTypes;
+					getGEPIndexedTypes(gep, indexedTypes);
+					for (unsigned i = 1; i < gep->getNumOperands(); i++) {
+						Type* AggOrPointerTy = indexedTypes[i - 1];
+						if (AggOrPointerTy == NULL) {
+							unknownTy = true;
+						} else if (AggOrPointerTy->isStructTy()) {
+							structIdx = true;
+						} else if (!AggOrPointerTy->isPointerTy() && !AggOrPointerTy->isArrayTy() && !AggOrPointerTy->isVectorTy()) {
+							unknownTy = true;
+						}
+						key.push_back(find(gep->getOperand(i)));
+					}
+
+					if (unknownTy) {
+						// reported by handle_gep
+					} else if (!structIdx) {
+						leader = find(gep->getPointerOperand());
+					} else {
+						auto git = geps.find(key);
+						if (git == geps.end()) {
+							geps[key] = inst;
+						} else if (git->second != inst) {
+							leader = git->second;
+						}
+					}
+					if (leader != NULL && leader != inst) {
+						gepNum++;
+					}
+				}
+
+				if (leader != NULL && leader != inst) {
+					leaders[inst] = leader;
+					valueNum++;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	for (auto& it : leaders) {
+		canonicalValues[it.first] = find(it.first);
+	}
+	outs() << "# Pointer-equivalent values: " << valueNum << " (" << gepNum << " GEPs)\n";
+}
+
 void AAAnalyzer::printNoAliasedPointerCalls() {
 	unsigned size = 0;
 
 	outs() << ">>>>>>>>>> Pointer calls that do not find any aliased function\n";
 	auto dfit = callgraph->begin();
 	while (dfit != callgraph->end()) {
-		DyckCallGraphNode * df = dfit->second;
-		set<PointerCall*>& unhandled = df->getPointerCalls();
+		DyckCallGraphNode * df = *dfit;
+		vector<PointerCall*>& unhandled = df->getPointerCalls();
 
 		auto pcit = unhandled.begin();
 		while (pcit != unhandled.end()) {
@@ -294,6 +698,24 @@ void AAAnalyzer::destroyFunctionGroups() {
 	tyroots.clear();
 }
 
+void AAAnalyzer::bucketFunctionGroups() {
+	set<FunctionTypeNode *>::iterator rit = tyroots.begin();
+	while (rit != tyroots.end()) {
+		FunctionTypeNode * root = *rit;
+		root->compatibleFuncsByRep.clear();
+
+		set<Function *>::iterator fit = root->compatibleFuncs.begin();
+		while (fit != root->compatibleFuncs.end()) {
+			DyckVertex* rep = dgraph->findDyckVertex(*fit);
+			if (rep != NULL) {
+				root->compatibleFuncsByRep[rep].insert(*fit);
+			}
+			fit++;
+		}
+		rit++;
+	}
+}
+
 void AAAnalyzer::combineFunctionGroups(FunctionType * ft1, FunctionType* ft2) {
 	if (!WithFunctionCastComb) {
 		return;
@@ -314,6 +736,12 @@ void AAAnalyzer::combineFunctionGroups(FunctionType * ft1, FunctionType* ft2) {
 /// return the structure's field vertex
 
 DyckVertex* AAAnalyzer::addField(DyckVertex* val, long fieldIndex, DyckVertex* field) {
+	vector<FunctionSummary::Ref> refs;
+	if (recording()) {
+		refs.push_back(summary->vertex(val));
+		refs.push_back(summary->vertex(field));
+	}
+
 	if (!field) {
 		set<DyckVertex*>* valrepset = val->getOutVertices((void*) (aa->getOrInsertIndexEdgeLabel(fieldIndex)));
 		if (valrepset && !valrepset->empty()) {
@@ -324,8 +752,14 @@ DyckVertex* AAAnalyzer::addField(DyckVertex* val, long fieldIndex, DyckVertex* f
 		}
 	} else {
 		val->addTarget(field, (void*) (aa->getOrInsertIndexEdgeLabel(fieldIndex)));
+		if (touchedVertices) {
+			touchedVertices->insert(val);
+		}
 	}
 
+	if (recording()) {
+		summary->record(FunctionSummary::FIELD, fieldIndex, refs, field);
+	}
 	return field;
 }
 
@@ -335,10 +769,17 @@ DyckVertex* AAAnalyzer::addField(DyckVertex* val, long fieldIndex, DyckVertex* f
 DyckVertex* AAAnalyzer::addPtrTo(DyckVertex* address, DyckVertex* val) {
 	assert((address || val) && "ERROR in addPtrTo\n");
 
+	vector<FunctionSummary::Ref> refs;
+	if (recording()) {
+		refs.push_back(summary->vertex(address));
+		refs.push_back(summary->vertex(val));
+	}
+
+	DyckVertex* ret;
 	if (!address) {
 		address = dgraph->retrieveDyckVertex(nullptr).first;
 		address->addTarget(val, (void*) aa->DEREF_LABEL);
-		return address;
+		ret = address;
 	} else if (!val) {
 		set<DyckVertex*>* derefset = address->getOutVertices((void*) aa->DEREF_LABEL);
 		if (derefset && !derefset->empty()) {
@@ -348,35 +789,235 @@ DyckVertex* AAAnalyzer::addPtrTo(DyckVertex* address, DyckVertex* val) {
 			address->addTarget(val, (void*) aa->DEREF_LABEL);
 		}
 
-		return val;
+		ret = val;
 	} else {
 		address->addTarget(val, (void*) aa->DEREF_LABEL);
-		return address;
+		ret = address;
+		if (touchedVertices) {
+			touchedVertices->insert(address);
+		}
 	}
 
+	if (recording()) {
+		summary->record(FunctionSummary::DEREF, 0, refs, ret);
+	}
+	return ret;
 }
 
 DyckVertex* AAAnalyzer::makeAlias(DyckVertex* x, DyckVertex* y) {
-	// combine x's rep and y's rep
-	return dgraph->combine(x, y);
+	if (touchedVertices) {
+		// one of them is destroyed
+		touchedVertices->erase(x);
+		touchedVertices->erase(y);
+		DyckVertex* ret = dgraph->combine(x, y);
+		touchedVertices->insert(ret);
+		return ret;
+	}
+
+	if (!recording()) {
+		// combine x's rep and y's rep
+		return dgraph->combine(x, y);
+	}
+
+	vector<FunctionSummary::Ref> refs;
+	refs.push_back(summary->vertex(x));
+	refs.push_back(summary->vertex(y));
+
+	DyckVertex* ret = dgraph->combine(x, y);
+	summary->forget(x, y);
+	summary->record(FunctionSummary::ALIAS, 0, refs, ret);
+	return ret;
 }
 
 void AAAnalyzer::makeContentAlias(DyckVertex* x, DyckVertex* y) {
 	addPtrTo(y, addPtrTo(x, nullptr));
 }
 
+void AAAnalyzer::addEdge(DyckVertex* from, DyckVertex* to, EdgeLabel::LABEL_TY kind, long num) {
+	if (recording()) {
+		vector<FunctionSummary::Ref> refs;
+		refs.push_back(summary->vertex(from));
+		refs.push_back(summary->vertex(to));
+		summary->record(kind == EdgeLabel::OFFSET_TYPE ? FunctionSummary::OFFSET_EDGE : FunctionSummary::INDEX_EDGE, num, refs);
+	}
+
+	if (kind == EdgeLabel::OFFSET_TYPE) {
+		from->addTarget(to, (void*) (aa->getOrInsertOffsetEdgeLabel(num)));
+	} else {
+		from->addTarget(to, (void*) (aa->getOrInsertIndexEdgeLabel(num)));
+	}
+	if (touchedVertices) {
+		touchedVertices->insert(from);
+	}
+}
+
+void AAAnalyzer::addCommonCall(DyckCallGraphNode* parent, Instruction* ret, Function* f, vector<Value*>* args) {
+	if (recording()) {
+		vector<std::string> names;
+		names.push_back(parent->getLLVMFunction()->getName().str());
+		names.push_back(f->getName().str());
+
+		vector<FunctionSummary::Ref> refs;
+		refs.push_back(summary->value(ret));
+		for (auto& arg : *args) {
+			refs.push_back(summary->value(arg));
+		}
+		summary->record(FunctionSummary::COMMON_CALL, names, refs);
+	}
+
+	parent->addCommonCall(callgraph->createCommonCall(ret, f, args));
+	aa->addCallSite(f, ret);
+}
+
+void AAAnalyzer::addPointerCall(DyckCallGraphNode* parent, Instruction* ret, Value* cv, vector<Value*>* args) {
+	if (recording()) {
+		vector<std::string> names;
+		names.push_back(parent->getLLVMFunction()->getName().str());
+
+		vector<FunctionSummary::Ref> refs;
+		refs.push_back(summary->value(ret));
+		refs.push_back(summary->value(cv));
+		for (auto& arg : *args) {
+			refs.push_back(summary->value(arg));
+		}
+		summary->record(FunctionSummary::POINTER_CALL, names, refs);
+	}
+
+	parent->addPointerCall(callgraph->createPointerCall(ret, cv, args));
+}
+
+void AAAnalyzer::replay_summary(FunctionSummary* fs, DyckCallGraphNode* parent) {
+	vector<DyckVertex*> vertices;
+	vertices.reserve(fs->getVertexNum());
+
+	// the ops returning the same vertex are in a union-find set, whose root
+	// holds the vertex, so combining two vertices only links two roots
+	vector<unsigned> parents;
+	parents.reserve(fs->getVertexNum());
+	map<DyckVertex*, unsigned> roots;
+
+	auto find = [&](unsigned idx) {
+		unsigned root = idx;
+		while (parents[root] != root) {
+			root = parents[root];
+		}
+		while (parents[idx] != root) {
+			unsigned next = parents[idx];
+			parents[idx] = root;
+			idx = next;
+		}
+		return root;
+	};
+
+	auto push = [&](DyckVertex* v) {
+		unsigned idx = vertices.size();
+		vertices.push_back(v);
+		auto it = roots.find(v);
+		if (it != roots.end()) {
+			parents.push_back(it->second);
+		} else {
+			parents.push_back(idx);
+			roots[v] = idx;
+		}
+	};
+
+	// 'n' is NULL, and 'v' is the vertex returned by an earlier op
+	auto vertexOf = [&](const FunctionSummary::Ref& r) {
+		return r.kind == 'v' ? vertices[find(r.idx)] : (DyckVertex*) NULL;
+	};
+
+	for (auto& op : fs->getOps()) {
+		vector<FunctionSummary::Ref>& refs = op.refs;
+		switch (op.kind) {
+		case FunctionSummary::WRAP:
+			push(wrapValue(fs->getValue(refs[0])));
+			break;
+		case FunctionSummary::DEREF:
+			push(addPtrTo(vertexOf(refs[0]), vertexOf(refs[1])));
+			break;
+		case FunctionSummary::FIELD:
+			push(addField(vertexOf(refs[0]), op.num, vertexOf(refs[1])));
+			break;
+		case FunctionSummary::ALIAS: {
+			DyckVertex* x = vertexOf(refs[0]);
+			DyckVertex* y = vertexOf(refs[1]);
+			DyckVertex* ret = makeAlias(x, y);
+			// the combined one is destroyed, so the ops returning x or y
+			// now return the new op's vertex
+			unsigned idx = vertices.size();
+			vertices.push_back(ret);
+			parents.push_back(idx);
+			parents[roots[x]] = idx;
+			parents[roots[y]] = idx;
+			roots.erase(x);
+			roots.erase(y);
+			roots[ret] = idx;
+		}
+			break;
+		case FunctionSummary::OFFSET_EDGE:
+			addEdge(vertexOf(refs[0]), vertexOf(refs[1]), EdgeLabel::OFFSET_TYPE, op.num);
+			break;
+		case FunctionSummary::INDEX_EDGE:
+			addEdge(vertexOf(refs[0]), vertexOf(refs[1]), EdgeLabel::INDEX_TYPE, op.num);
+			break;
+		case FunctionSummary::CAST_COMB: {
+			Instruction* cast = (Instruction*) fs->getValue(refs[0]);
+			Type* origTy = cast->getOperand(0)->getType();
+			Type* castTy = cast->getType();
+			combineFunctionGroups((FunctionType*) origTy->getPointerElementType(), (FunctionType*) castTy->getPointerElementType());
+		}
+			break;
+		case FunctionSummary::RET:
+			parent->addRet(fs->getValue(refs[0]));
+			break;
+		case FunctionSummary::RESUME:
+			parent->addResume(fs->getValue(refs[0]));
+			break;
+		case FunctionSummary::INLINE_ASM:
+			parent->addInlineAsm((CallInst*) fs->getValue(refs[0]));
+			break;
+		case FunctionSummary::VA_ARG:
+			parent->addVAArg(fs->getValue(refs[0]));
+			break;
+		case FunctionSummary::COMMON_CALL:
+		case FunctionSummary::POINTER_CALL: {
+			// the caller is not always the function, e.g. for pthread_create
+			DyckCallGraphNode* caller = callgraph->getOrInsertFunction(module->getFunction(op.names[0]));
+			Instruction* ret = (Instruction*) fs->getValue(refs[0]);
+
+			unsigned firstArg = op.kind == FunctionSummary::COMMON_CALL ? 1 : 2;
+			vector<Value*> args;
+			for (unsigned i = firstArg; i < refs.size(); i++) {
+				args.push_back(fs->getValue(refs[i]));
+			}
+
+			if (op.kind == FunctionSummary::COMMON_CALL) {
+				addCommonCall(caller, ret, module->getFunction(op.names[1]), &args);
+			} else {
+				addPointerCall(caller, ret, fs->getValue(refs[1]), &args);
+			}
+		}
+			break;
+		default:
+			assert(false && "Unknown summary op!");
+			break;
+		}
+	}
+}
+
 DyckVertex* AAAnalyzer::handle_gep(GEPOperator* gep) {
 	Value * ptr = gep->getPointerOperand();
 	DyckVertex* current = wrapValue(ptr);
 
-	gep_type_iterator GTI = gep_type_begin(gep); // preGTI is the PointerTy of ptr
+	vector<Type*> indexedTypes;
+	getGEPIndexedTypes(gep, indexedTypes);
 
 	int num_indices = gep->getNumIndices();
 	int idxidx = 0;
 	while (idxidx < num_indices) {
 		Value * idx = gep->getOperand(++idxidx);
-		Type * AggOrPointerTy = *(GTI++);
-		// Type * ElmtTy = *GTI;
+		Type * AggOrPointerTy = indexedTypes[idxidx - 1];
+		assert(AggOrPointerTy && "ERROR: when dealing with gep");
 
 		ConstantInt * ci = dyn_cast<ConstantInt>(idx);
 
@@ -385,16 +1026,17 @@ DyckVertex* AAAnalyzer::handle_gep(GEPOperator* gep) {
 			// s1: y--deref-->?1--(fieldIdx idxLabel)-->?2
 			DyckVertex* theStruct = this->addPtrTo(current, nullptr);
 
-			assert(ci && "ERROR: when dealing with gep");
+			// a struct index of a vector GEP is a splat vector
+			assert(isa<Constant>(idx) && "ERROR: when dealing with gep");
 
 			// s2: ?3--deref-->?2
-			unsigned fieldIdx = (unsigned) (*(ci->getValue().getRawData()));
+			unsigned fieldIdx = (unsigned) ((Constant*) idx)->getUniqueInteger().getZExtValue();
 			DyckVertex* field = this->addField(theStruct, fieldIdx, nullptr);
 			DyckVertex* fieldPtr = this->addPtrTo(nullptr, field);
 
 			// the label representation and feature impl is temporal.
 			// s3: y--(fieldIdx offLabel)-->?3
-			current->addTarget(fieldPtr, (void*) (aa->getOrInsertOffsetEdgeLabel(fieldIdx)));
+			this->addEdge(current, fieldPtr, EdgeLabel::OFFSET_TYPE, fieldIdx);
 
 			// update current
 			current = fieldPtr;
@@ -412,6 +1054,37 @@ DyckVertex* AAAnalyzer::handle_gep(GEPOperator* gep) {
 }
 
 DyckVertex* AAAnalyzer::wrapValue(Value * v) {
+	if (recording()) {
+		// the operations done for constants are not recorded, since they
+		// are done again when the summary is replayed
+		vector<FunctionSummary::Ref> refs;
+		refs.push_back(summary->value(v));
+
+		summaryDepth++;
+		DyckVertex* ret = wrapValue(v);
+		summaryDepth--;
+
+		summary->record(FunctionSummary::WRAP, 0, refs, ret);
+		return ret;
+	}
+
+	// a value known to be equivalent to another shares its vertex
+	if (v != NULL && !canonicalValues.empty()) {
+		auto cit = canonicalValues.find(v);
+		if (cit != canonicalValues.end()) {
+			DyckVertex* ver = dgraph->findDyckVertex(v);
+			if (ver == NULL) {
+				DyckVertex* canonical = wrapValue(cit->second);
+				// v may have been wrapped with the canonical value, e.g. in its initializer
+				ver = dgraph->findDyckVertex(v);
+				if (ver == NULL) {
+					ver = dgraph->bindDyckVertex(v, canonical);
+				}
+			}
+			return ver;
+		}
+	}
+
 	// if the vertex of v exists, return it, otherwise create one
 	pair<DyckVertex*, bool> retpair = dgraph->retrieveDyckVertex(v);
 	if (retpair.second || !v) {
@@ -657,7 +1330,33 @@ void AAAnalyzer::handle_instrinsic(Instruction *inst) {
 		//Specialised Arithmetic Intrinsics
 		//Half Precision Floating Point Intrinsics
 		//Debugger Intrinsics
-	default:
+	default: {
+		// gathers and scatters are not known by LLVM 3.6, but a vectorizer
+		// may emit them; a vector of pointers is one vertex, which points
+		// to what all the lanes point to
+		StringRef name = call->getCalledFunction() ? call->getCalledFunction()->getName() : "";
+		if (name.startswith("llvm.masked.gather.") && call->getNumArgOperands() == 4) {
+			// semantics:
+			// vec_load = load each lane of ptrs
+			// vec_return = select mask vec_load vec_passthru
+			Value* ptrs = call->getArgOperand(0);
+			Value* vec_passthru = call->getArgOperand(3);
+
+			this->makeAlias(wrapValue(call), wrapValue(vec_passthru));
+			this->addPtrTo(wrapValue(ptrs), wrapValue(call));
+
+			// 0b1001
+			mask |= 9;
+		} else if (name.startswith("llvm.masked.scatter.") && call->getNumArgOperands() == 4) {
+			Value* vec = call->getArgOperand(0);
+			Value* ptrs = call->getArgOperand(1);
+
+			this->addPtrTo(wrapValue(ptrs), wrapValue(vec));
+
+			// 0b11
+			mask |= 3;
+		}
+	}
 		break;
 	}
 
@@ -670,9 +1369,37 @@ void AAAnalyzer::handle_instrinsic(Instruction *inst) {
 	wrapValue(call->getCalledValue());
 }
 
-set<Function*>* AAAnalyzer::getCompatibleFunctions(FunctionType * fty) {
+set<Function*>* AAAnalyzer::getCompatibleFunctions(FunctionType * fty, DyckVertex* rep) {
 	FunctionTypeNode * ftn = this->initFunctionGroup(fty);
-	return &(ftn->root->compatibleFuncs);
+	auto bit = ftn->root->compatibleFuncsByRep.find(rep);
+	if (bit != ftn->root->compatibleFuncsByRep.end()) {
+		return &(bit->second);
+	}
+	return NULL;
+}
+
+/// If the called value is a function via casts and aliases, return the function.
+Function* AAAnalyzer::getCalledFunction(Value* calledValue) {
+	Value * cvcopy = calledValue->stripPointerCastsNoFollowAliases();
+	Value * temp = cvcopy;
+	do {
+		temp = cvcopy;
+
+		while (isa<ConstantExpr>(cvcopy) && ((ConstantExpr*) cvcopy)->isCast()) {
+			cvcopy = ((ConstantExpr*) cvcopy)->getOperand(0)->stripPointerCastsNoFollowAliases();
+		}
+
+		while (isa<Instruction>(cvcopy) && ((Instruction*) cvcopy)->isCast()) {
+			cvcopy = ((Instruction*) cvcopy)->getOperand(0)->stripPointerCastsNoFollowAliases();
+		}
+
+		while (isa<GlobalAlias>(cvcopy)) {
+			cvcopy = ((GlobalAlias*) cvcopy)->getAliasee()->stripPointerCastsNoFollowAliases();
+		}
+
+	} while (cvcopy != temp);
+
+	return dyn_cast<Function>(cvcopy);
 }
 
 void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func) {
@@ -685,12 +1412,18 @@ void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func)
 		ReturnInst* retInst = ((ReturnInst*) inst);
 		if (retInst->getNumOperands() > 0 && !retInst->getOperandUse(0)->getType()->isVoidTy()) {
 			parent_func->addRet(retInst->getOperandUse(0));
+			if (recording()) {
+				summary->record(FunctionSummary::RET, 0, vector<FunctionSummary::Ref>(1, summary->value(retInst->getOperandUse(0))));
+			}
 		}
 	}
 		break;
 	case Instruction::Resume: {
 		Value* resume = ((ResumeInst*) inst)->getOperand(0);
 		parent_func->addResume(resume);
+		if (recording()) {
+			summary->record(FunctionSummary::RESUME, 0, vector<FunctionSummary::Ref>(1, summary->value(resume)));
+		}
 	}
 		break;
 	case Instruction::Switch:
@@ -810,6 +1543,12 @@ void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func)
 	}
 		break;
 	case Instruction::GetElementPtr: {
+		if (canonicalValues.count(inst)) {
+			// an equivalent value has been or will be handled, only the
+			// operands are wrapped
+			wrapValue(inst);
+			break;
+		}
 		makeAlias(wrapValue(inst), handle_gep((GEPOperator*) inst));
 
 		mask |= (~0);
@@ -840,6 +1579,9 @@ void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func)
 		if (origTy->isPointerTy() && origTy->getPointerElementType()->isFunctionTy() && castTy->isPointerTy()
 				&& castTy->getPointerElementType()->isFunctionTy()) {
 			combineFunctionGroups((FunctionType*) origTy->getPointerElementType(), (FunctionType*) castTy->getPointerElementType());
+			if (recording()) {
+				summary->record(FunctionSummary::CAST_COMB, 0, vector<FunctionSummary::Ref>(1, summary->value(inst)));
+			}
 		}
 
 		mask |= (~0);
@@ -871,6 +1613,9 @@ void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func)
 
 		if (callinst->isInlineAsm()) {
 			parent_func->addInlineAsm(callinst);
+			if (recording()) {
+				summary->record(FunctionSummary::INLINE_ASM, 0, vector<FunctionSummary::Ref>(1, summary->value(callinst)));
+			}
 			break;
 		}
 
@@ -912,6 +1657,9 @@ void AAAnalyzer::handle_inst(Instruction *inst, DyckCallGraphNode * parent_func)
 		break;
 	case Instruction::VAArg: {
 		parent_func->addVAArg(inst);
+		if (recording()) {
+			summary->record(FunctionSummary::VA_ARG, 0, vector<FunctionSummary::Ref>(1, summary->value(inst)));
+		}
 
 		DyckVertex* vaarg = wrapValue(inst);
 		Value * ptrVaarg = inst->getOperand(0);
@@ -971,7 +1719,7 @@ void AAAnalyzer::handle_invoke_call_inst(Instruction * ret, Value* cv, vector<Va
 			handle_instrinsic((Instruction*) ret);
 		} else {
 			this->handle_lib_invoke_call_inst(ret, (Function*) cv, args, parent);
-			parent->addCommonCall(new CommonCall(ret, (Function*) cv, args));
+			this->addCommonCall(parent, ret, (Function*) cv, args);
 		}
 	} else {
 		wrapValue(cv);
@@ -984,10 +1732,9 @@ void AAAnalyzer::handle_invoke_call_inst(Instruction * ret, Value* cv, vector<Va
 
 			if (isa<Function>(cvcopy)) {
 				this->handle_lib_invoke_call_inst(ret, (Function*) cvcopy, args, parent);
-				parent->addCommonCall(new CommonCall(ret, (Function*) cvcopy, args));
+				this->addCommonCall(parent, ret, (Function*) cvcopy, args);
 			} else {
-				PointerCall* pcall = new PointerCall(ret, cv, args);
-				parent->addPointerCall(pcall);
+				this->addPointerCall(parent, ret, cv, args);
 			}
 		} else if (isa<GlobalAlias>(cv)) {
 			Value * cvcopy = cv;
@@ -997,14 +1744,12 @@ void AAAnalyzer::handle_invoke_call_inst(Instruction * ret, Value* cv, vector<Va
 
 			if (isa<Function>(cvcopy)) {
 				this->handle_lib_invoke_call_inst(ret, (Function*) cvcopy, args, parent);
-				parent->addCommonCall(new CommonCall(ret, (Function*) cvcopy, args));
+				this->addCommonCall(parent, ret, (Function*) cvcopy, args);
 			} else {
-				PointerCall* pcall = new PointerCall(ret, cv, args);
-				parent->addPointerCall(pcall);
+				this->addPointerCall(parent, ret, cv, args);
 			}
 		} else {
-			PointerCall * pcall = new PointerCall(ret, cv, args);
-			parent->addPointerCall(pcall);
+			this->addPointerCall(parent, ret, cv, args);
 		}
 	}
 }
@@ -1099,80 +1844,84 @@ void AAAnalyzer::handle_common_function_call(Call* c, DyckCallGraphNode* caller,
 	}
 }
 
-bool AAAnalyzer::handle_pointer_function_calls(DyckCallGraphNode* caller, int FUNCTION_COUNT) {
+bool AAAnalyzer::handle_pointer_function_calls(DyckCallGraphNode* caller, Progress& progress) {
 	bool ret = false;
 
-	set<PointerCall*>& pointercalls = caller->getPointerCalls();
-	set<PointerCall*>::iterator mit = pointercalls.begin();
-
-// print in console
-	int PTCALL_TOTAL = pointercalls.size();
-	int PTCALL_COUNT = 0;
-	if (PTCALL_TOTAL == 0)
-		outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... 100%, 100%. Done!\r";
+	vector<PointerCall*>& pointercalls = caller->getPointerCalls();
 
-	while (mit != pointercalls.end()) {
-		// print in console
-		int percentage = ((++PTCALL_COUNT) * 100 / PTCALL_TOTAL);
-		outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << percentage << "%, \r";
+	// pointer calls may be added while handling them, e.g. by pthread_create
+	for (unsigned i = 0; i < pointercalls.size(); i++) {
+		progress.step();
 
-		PointerCall * pcall = *mit;
+		PointerCall * pcall = pointercalls[i];
 		Type* fty = pcall->calledValue->getType()->getPointerElementType();
 		assert(fty->isFunctionTy() && "Error in AAAnalyzer::handle_pointer_function_calls!");
 
-		// handle each unhandled, possible function
-		set<Value*> equivAndTypeCompSet;
-		const set<Value*>* equivSet = aa->getAliasSet(pcall->calledValue);
-		set<Function*>* cands = this->getCompatibleFunctions((FunctionType*) fty);
-		set_intersection(cands->begin(), cands->end(), equivSet->begin(), equivSet->end(),
-				inserter(equivAndTypeCompSet, equivAndTypeCompSet.begin()));
-
-		set<Value*> unhandled_function;
-		set<Function*>* maycallfuncs = &(pcall->mayAliasedCallees);
-		set_difference(equivAndTypeCompSet.begin(), equivAndTypeCompSet.end(), maycallfuncs->begin(), maycallfuncs->end(),
-				inserter(unhandled_function, unhandled_function.begin()));
-
-		// print in console
-		int CAND_TOTAL = unhandled_function.size();
-		int CAND_COUNT = 0;
-		if (CAND_TOTAL == 0 || pcall->mustAliasedPointerCall) {
-			outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << "100%, 100%. Done!\r";
-			mit++;
+		// the call is left until it may change the demanded vertices, and
+		// then the called value is demanded so that its class is complete
+		if (!this->isDemanded(pcall, (FunctionType*) fty)) {
 			continue;
 		}
+		if (demandDriven && demandedValues.insert(pcall->calledValue).second) {
+			ret = true;
+		}
+
+		// handle each unhandled, possible function, i.e. a type compatible
+		// function that has the same representative as the called value
+		vector<Function*> unhandled_function;
+		SetVector<Function*>* maycallfuncs = &(pcall->mayAliasedCallees);
+		DyckVertex* cvRep = dgraph->retrieveDyckVertex(pcall->calledValue).first;
+		set<Function*>* cands = this->getCompatibleFunctions((FunctionType*) fty, cvRep);
+		if (cands != NULL && !pcall->mustAliasedPointerCall) {
+			auto cit = cands->begin();
+			while (cit != cands->end()) {
+				// the bucket may be stale if vertices are combined in this iteration
+				if (!maycallfuncs->count(*cit) && dgraph->findDyckVertex(*cit) == cvRep) {
+					unhandled_function.push_back(*cit);
+				}
+				cit++;
+			}
+		}
+
+		if (unhandled_function.empty()) {
+			continue;
+		}
+
+		// the candidates are kept by addresses, so they are handled in the
+		// order of the call graph to make the results reproducible
+		sort(unhandled_function.begin(), unhandled_function.end(), [this](Function* a, Function* b) {
+			return callgraph->getOrInsertFunction(a)->getIndex() < callgraph->getOrInsertFunction(b)->getIndex();
+		});
+
+		// a function via casts or aliases can only be called by itself
+		Function* calledFunction = getCalledFunction(pcall->calledValue);
 
 		auto pfit = unhandled_function.begin();
 		while (pfit != unhandled_function.end()) {
-			Function * mayAliasedFunctioin = (Function*) (*pfit);
-			// print in console
-			int RATE = ((100 * (++CAND_COUNT)) / CAND_TOTAL);
-			if (percentage == 100 && RATE == 100) {
-				outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << "100%, 100%. Done!\r";
-			} else {
-				outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << percentage << "%, " << RATE << "%         \r";
-			}
+			Function * mayAliasedFunctioin = *pfit;
 
-			AliasAnalysis::AliasResult ar = aa->alias(mayAliasedFunctioin, pcall->calledValue);
-			if (ar == AliasAnalysis::MayAlias || ar == AliasAnalysis::MustAlias) {
+			if (calledFunction == NULL || calledFunction == mayAliasedFunctioin) {
 				ret = true;
 				maycallfuncs->insert(mayAliasedFunctioin);
+				aa->addCallSite(mayAliasedFunctioin, pcall->instruction);
 
 				handle_common_function_call(pcall, caller, callgraph->getOrInsertFunction(mayAliasedFunctioin));
 				handle_lib_invoke_call_inst(pcall->instruction, mayAliasedFunctioin, &(pcall->args), caller);
 
-				if (ar == AliasAnalysis::MustAlias) {
-					// print in console
+				if (calledFunction != NULL) {
 					pcall->mustAliasedPointerCall = true;
+					for (auto& f : pcall->mayAliasedCallees) {
+						if (f != mayAliasedFunctioin) {
+							aa->removeCallSite(f, pcall->instruction);
+						}
+					}
 					pcall->mayAliasedCallees.clear();
 					pcall->mayAliasedCallees.insert(mayAliasedFunctioin);
-					outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << "100%, 100%. Done!\r";
 					break;
 				}
 			}
 			pfit++;
 		}
-
-		mit++;
 	}
 
 	return ret;
@@ -1183,85 +1932,41 @@ void AAAnalyzer::handle_lib_invoke_call_inst(Value* ret, Function* f, vector<Val
 	if (!f->empty() || f->isIntrinsic())
 		return;
 
-	const string& functionName = f->getName().str();
-	switch (args->size()) {
-	case 1: {
-		if (functionName == "strdup" || functionName == "__strdup" || functionName == "strdupa") {
-			// content alias r/1st
-			this->makeContentAlias(wrapValue(args->at(0)), wrapValue(ret));
-		} else if (functionName == "pthread_getspecific" && ret) {
-			DyckVertex* keyRep = wrapValue(args->at(0));
-			DyckVertex* valRep = wrapValue(ret);
-			// we use label -1 to indicate that it is a key:value pair
-			keyRep->addTarget(valRep, aa->getOrInsertIndexEdgeLabel(-1));
-		}
-	}
-		break;
-	case 2: {
-		if (functionName == "strcat" || functionName == "strcpy") {
-			if (ret) {
-				DyckVertex * dst_ptr = wrapValue(args->at(0));
-				DyckVertex * src_ptr = wrapValue(args->at(1));
-
-				this->makeContentAlias(dst_ptr, src_ptr);
-				this->makeAlias(wrapValue(ret), dst_ptr);
-			} else {
-				errs() << "ERROR strcat/cpy does not return.\n";
-				exit(1);
-			}
-		} else if (functionName == "strndup" || functionName == "strndupa") {
-			// content alias r/1st
-			this->makeContentAlias(wrapValue(args->at(0)), wrapValue(ret));
-		} else if (functionName == "strstr" || functionName == "strcasestr") {
-			// content alias r/2nd
-			this->makeContentAlias(wrapValue(args->at(1)), wrapValue(ret));
-			// alias r/1st
-			this->makeAlias(wrapValue(ret), wrapValue(args->at(0)));
-		} else if (functionName == "strchr" || functionName == "strrchr" || functionName == "strchrnul" || functionName == "rawmemchr") {
-			// alias r/1st
-			this->makeAlias(wrapValue(ret), wrapValue(args->at(0)));
-		} else if (functionName == "strtok") {
-			// content alias r/1st
-			this->makeContentAlias(wrapValue(args->at(0)), wrapValue(ret));
-		} else if (functionName == "pthread_setspecific") {
-			DyckVertex* keyRep = wrapValue(args->at(0));
-			DyckVertex* valRep = wrapValue(args->at(1));
+	const LibrarySpec::FunctionSpec* spec = aa->getLibrarySpec()->lookup(f, args->size());
+	if (spec == NULL)
+		return;
+
+	for (auto& r : spec->relations) {
+		// the return value, or an argument
+		if (r.x > args->size() || r.y > args->size())
+			continue;
+		Value* x = r.x == LibrarySpec::RET ? ret : args->at(r.x - 1);
+		Value* y = r.y == LibrarySpec::RET ? ret : args->at(r.y - 1);
+		if (x == NULL || y == NULL)
+			continue;
+
+		switch (r.kind) {
+		case LibrarySpec::ALIAS:
+			this->makeAlias(wrapValue(x), wrapValue(y));
+			break;
+		case LibrarySpec::CONTENT_ALIAS:
+			this->makeContentAlias(wrapValue(x), wrapValue(y));
+			break;
+		case LibrarySpec::KEY_VALUE:
 			// we use label -1 to indicate that it is a key:value pair
-			keyRep->addTarget(valRep, aa->getOrInsertIndexEdgeLabel(-1));
-		}
-	}
-		break;
-	case 3: {
-		if (functionName == "strncat" || functionName == "strncpy" || functionName == "memcpy" || functionName == "memmove") {
-			if (ret) {
-				DyckVertex * dst_ptr = wrapValue(args->at(0));
-				DyckVertex * src_ptr = wrapValue(args->at(1));
-
-				this->makeContentAlias(dst_ptr, src_ptr);
-				this->makeAlias(wrapValue(ret), dst_ptr);
-			} else {
-				errs() << "ERROR strncat/cpy does not return.\n";
-				exit(1);
-			}
-		} else if (functionName == "memchr" || functionName == "memrchr" || functionName == "memset") {
-			// alias r/1st
-			this->makeAlias(wrapValue(ret), wrapValue(args->at(0)));
-		} else if (functionName == "strtok_r" || functionName == "__strtok_r") {
-			// content alias r/1st
-			this->makeContentAlias(wrapValue(args->at(0)), wrapValue(ret));
-		}
-	}
-		break;
-	case 4: {
-		if (functionName == "pthread_create") {
+			this->addEdge(wrapValue(x), wrapValue(y), EdgeLabel::INDEX_TYPE, -1);
+			break;
+		case LibrarySpec::SPAWN: {
 			vector<Value*> xargs;
-			xargs.push_back(args->at(3));
+			xargs.push_back(y);
 			DyckCallGraphNode* parent = callgraph->getOrInsertFunction(f);
-			this->handle_invoke_call_inst(nullptr, args->at(2), &xargs, parent);
+			this->handle_invoke_call_inst(nullptr, x, &xargs, parent);
+		}
+			break;
+		case LibrarySpec::MOD:
+		case LibrarySpec::REF:
+			// used by the mod/ref summaries only
+			break;
 		}
-	}
-		break;
-	default:
-		break;
 	}
 }
@@ -0,0 +1,168 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "DyckAA/AllocSiteIndex.h"
+
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/InstIterator.h"
+
+#include <stdio.h>
+
+// bump it if the format changes
+#define ALLOC_SITE_INDEX_VERSION 1
+
+AllocSiteIndex::AllocSiteIndex(Module* M, DyckGraph* dgraph, const std::set<Function*>& allocators) :
+		dgraph(dgraph) {
+	for (auto f : allocators) {
+		allocatorFuncs.insert(f);
+		if (DyckVertex* rep = dgraph->findDyckVertex(f)) {
+			allocatorReps.insert(rep);
+		}
+	}
+
+	// the sites are numbered in the order of the module, so that the
+	// saved index does not depend on the addresses of the vertices
+	for (auto git = M->global_begin(); git != M->global_end(); ++git) {
+		addSite(&*git);
+	}
+	for (auto fit = M->begin(); fit != M->end(); ++fit) {
+		addSite(&*fit);
+	}
+	for (auto fit = M->begin(); fit != M->end(); ++fit) {
+		for (inst_iterator it = inst_begin(&*fit); it != inst_end(&*fit); ++it) {
+			Instruction* inst = &*it;
+			if (isa<AllocaInst>(inst)) {
+				addSite(inst);
+			} else if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
+				if (isAllocator(CallSite(inst).getCalledValue())) {
+					addSite(inst);
+				}
+			}
+		}
+	}
+
+	// group the sites by their representatives, keeping their order
+	repOffsets.assign(reps.size() + 1, 0);
+	for (auto r : siteReps) {
+		repOffsets[r + 1]++;
+	}
+	for (unsigned i = 0; i < reps.size(); i++) {
+		repOffsets[i + 1] += repOffsets[i];
+	}
+	repSites.resize(sites.size());
+	vector<unsigned> next(repOffsets.begin(), repOffsets.end() - 1);
+	for (unsigned i = 0; i < sites.size(); i++) {
+		repSites[next[siteReps[i]]++] = sites[i];
+	}
+}
+
+void AllocSiteIndex::addSite(Value* site) {
+	DyckVertex* rep = dgraph->findDyckVertex(site);
+	if (rep == NULL) {
+		return;
+	}
+
+	auto res = repNumbers.insert(std::make_pair(rep, (unsigned) reps.size()));
+	if (res.second) {
+		reps.push_back(rep);
+	}
+
+	siteNumbers[site] = sites.size();
+	sites.push_back(site);
+	siteReps.push_back(res.first->second);
+}
+
+bool AllocSiteIndex::isAllocator(Value* calledValue) const {
+	if (isa<Function>(calledValue)) {
+		return allocatorFuncs.count((Function*) calledValue);
+	}
+	DyckVertex* rep = dgraph->findDyckVertex(calledValue);
+	return rep != NULL && allocatorReps.count(rep);
+}
+
+ArrayRef<Value*> AllocSiteIndex::getSites(DyckVertex* rep) const {
+	auto it = repNumbers.find(rep);
+	if (it == repNumbers.end()) {
+		return ArrayRef<Value*>();
+	}
+	unsigned r = it->second;
+	return ArrayRef<Value*>(repSites.data() + repOffsets[r], repOffsets[r + 1] - repOffsets[r]);
+}
+
+DyckVertex* AllocSiteIndex::getRepresentative(Value* site) const {
+	auto it = siteNumbers.find(site);
+	if (it == siteNumbers.end()) {
+		return NULL;
+	}
+	return reps[siteReps[it->second]];
+}
+
+/* ************************************************************************
+ * The format
+ *
+ *     dyck-alloc-sites <version>
+ *     sites <n>
+ *     <rep> <kind> <name> <index> <line>
+ *     reps <n>
+ *     <n> <site>...
+ *
+ * where a kind is g (global), f (function), s (alloca) or h (heap); a name
+ * is written as <length>:<chars>, which is the function of an instruction,
+ * and the index is the position of the instruction in the function (-1 for
+ * globals and functions). Sites and representatives are referred to by
+ * their positions in the lists.
+ * ************************************************************************/
+
+static void writeName(FILE* fp, StringRef name) {
+	fprintf(fp, " %lu:", (unsigned long) name.size());
+	fwrite(name.data(), 1, name.size(), fp);
+}
+
+bool AllocSiteIndex::save(const std::string& file) const {
+	FILE* fp = fopen(file.c_str(), "w");
+	if (!fp) {
+		return false;
+	}
+
+	// positions of the instructions in their functions
+	DenseMap<Function*, DenseMap<Instruction*, unsigned> > positions;
+
+	fprintf(fp, "dyck-alloc-sites %d\nsites %lu\n", ALLOC_SITE_INDEX_VERSION, (unsigned long) sites.size());
+	for (unsigned i = 0; i < sites.size(); i++) {
+		Value* site = sites[i];
+		fprintf(fp, "%u", siteReps[i]);
+		if (Instruction* inst = dyn_cast<Instruction>(site)) {
+			Function* f = inst->getParent()->getParent();
+			DenseMap<Instruction*, unsigned>& fpos = positions[f];
+			if (fpos.empty()) {
+				unsigned pos = 0;
+				for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+					fpos[&*it] = pos++;
+				}
+			}
+			fprintf(fp, " %c", isa<AllocaInst>(inst) ? 's' : 'h');
+			writeName(fp, f->getName());
+			fprintf(fp, " %u %u\n", fpos[inst], inst->getDebugLoc().getLine());
+		} else {
+			fprintf(fp, " %c", isa<Function>(site) ? 'f' : 'g');
+			writeName(fp, site->getName());
+			fprintf(fp, " -1 0\n");
+		}
+	}
+
+	fprintf(fp, "reps %lu\n", (unsigned long) reps.size());
+	unsigned s = 0;
+	for (unsigned r = 0; r < reps.size(); r++) {
+		fprintf(fp, "%u", repOffsets[r + 1] - repOffsets[r]);
+		for (; s < repOffsets[r + 1]; s++) {
+			fprintf(fp, " %u", siteNumbers.find(repSites[s])->second);
+		}
+		fprintf(fp, "\n");
+	}
+
+	bool ok = !ferror(fp);
+	return fclose(fp) == 0 && ok;
+}
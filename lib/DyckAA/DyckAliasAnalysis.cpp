@@ -5,6 +5,7 @@
 
 #define DEBUG_TYPE "dyckaa"
 #include "DyckAA/DyckAliasAnalysis.h"
+#include "DyckAA/ModuleSummary.h"
 #include "DyckCG/DyckCallGraph.h"
 
 #include <stdio.h>
@@ -13,6 +14,12 @@
 
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/Statistic.h"
+
+STATISTIC(NumRepAliasQueries, "Number of alias queries between two representatives");
+STATISTIC(NumRepAliasCacheHits, "Number of alias queries answered by the representative cache");
+STATISTIC(NumModRefNarrowed, "Number of call mod/ref results narrowed by the summaries");
 
 static cl::opt<bool> PrintAliasSetInformation("print-alias-set-info", cl::init(false), cl::Hidden,
 		cl::desc("Output all alias sets, their relations and the evaluation results."));
@@ -23,6 +30,21 @@ static cl::opt<bool> PreserveCallGraph("preserve-dyck-callgraph", cl::init(false
 static cl::opt<bool> DotCallGraph("dot-dyck-callgraph", cl::init(false), cl::Hidden,
 		cl::desc("Calculate the program's call graph and output into a \"dot\" file."));
 
+static cl::opt<bool> DemandDriven("dyckaa-demand-driven", cl::init(false), cl::Hidden,
+		cl::desc("Resolve calls only for the values that are queried, when they are queried."));
+
+static cl::opt<std::string> ExportSummary("dyckaa-export-summary", cl::init(""), cl::Hidden,
+		cl::desc("Save a summary of the module into the file, which can be merged with those of other modules by dyckmerge."));
+
+static cl::opt<std::string> ExportAllocSites("dyckaa-export-alloc-sites", cl::init(""), cl::Hidden,
+		cl::desc("Save the allocation sites of the alias sets into the file."));
+
+static cl::list<std::string> LibSpecFiles("dyckaa-lib-spec", cl::CommaSeparated, cl::Hidden,
+		cl::desc("Load the specs of library functions in the files, in addition to the built-in one."));
+
+static cl::opt<bool> NoModRefSummaries("dyckaa-no-modref", cl::init(false), cl::Hidden,
+		cl::desc("Do not narrow the mod/ref results of calls by the summaries of the callees."));
+
 static cl::opt<bool> CountFP("count-fp", cl::init(false), cl::Hidden, cl::desc("Calculate how many functions a function pointer may point to."));
 
 static const Function *getParent(const Value *V) {
@@ -47,27 +69,32 @@ DyckAliasAnalysis::DyckAliasAnalysis() :
 		ModulePass(ID) {
 	dyck_graph = new DyckGraph;
 	call_graph = new DyckCallGraph;
+	demand_analyzer = NULL;
+	lib_spec = new LibrarySpec;
+	alloc_sites = NULL;
+	module = NULL;
 
-	DEREF_LABEL = new DerefEdgeLabel;
+	DEREF_LABEL = derefLabelAllocator.create();
 }
 
 DyckAliasAnalysis::~DyckAliasAnalysis() {
+	delete demand_analyzer;
 	delete call_graph;
 	delete dyck_graph;
+	delete lib_spec;
 
-	// delete edge labels
-	delete DEREF_LABEL;
+	// edge labels are released by their allocators
 
-	auto olIt = OFFSET_LABEL_MAP.begin();
-	while (olIt != OFFSET_LABEL_MAP.end()) {
-		delete olIt->second;
-		olIt++;
+	auto etIt = escapedToMap.begin();
+	while (etIt != escapedToMap.end()) {
+		delete etIt->second;
+		etIt++;
 	}
 
-	auto ilIt = INDEX_LABEL_MAP.begin();
-	while (ilIt != INDEX_LABEL_MAP.end()) {
-		delete ilIt->second;
-		ilIt++;
+	delete alloc_sites;
+
+	for (auto s : modRefSummaryList) {
+		delete s;
 	}
 }
 
@@ -85,7 +112,10 @@ DyckAliasAnalysis::AliasResult DyckAliasAnalysis::alias(const Location &LocA, co
 
 	AliasResult ret = MayAlias;
 	if (notDifferentParent(LocA.Ptr, LocB.Ptr)) {
-		ret = AliasAnalysis::alias(LocA, LocB);
+		{
+			std::lock_guard<std::recursive_mutex> guard(chainMutex);
+			ret = AliasAnalysis::alias(LocA, LocB);
+		}
 		if (ret != MayAlias) {
 			return ret;
 		}
@@ -97,19 +127,12 @@ DyckAliasAnalysis::AliasResult DyckAliasAnalysis::alias(const Location &LocA, co
 		return ret;
 	}
 
-	pair<DyckVertex*, bool> retpair = dyck_graph->retrieveDyckVertex(const_cast<Value*>(LocA.Ptr));
-	DyckVertex * VA = retpair.first;
+	this->demand(LocA.Ptr);
+	this->demand(LocB.Ptr);
 
-	retpair = dyck_graph->retrieveDyckVertex(const_cast<Value*>(LocB.Ptr));
-	DyckVertex * VB = retpair.first;
-
-	if (VA == VB) {
-		ret = MayAlias;
-	} else if (isPartialAlias(VA, VB) || isPartialAlias(VB, VA)) {
-		ret = PartialAlias;
-	} else {
-		ret = NoAlias;
-	}
+	DyckVertex * VA = dyck_graph->findDyckVertex(const_cast<Value*>(LocA.Ptr));
+	DyckVertex * VB = dyck_graph->findDyckVertex(const_cast<Value*>(LocB.Ptr));
+	ret = aliasRepresentatives(VA, VB);
 
 	if (ret == MayAlias && (isa<Function>(LocA.Ptr) || isa<Function>(LocB.Ptr))) {
 		const Function* function = isa<Function>(LocA.Ptr) ? (const Function*) LocA.Ptr : (const Function*) LocB.Ptr;
@@ -156,10 +179,48 @@ INITIALIZE_AG_PASS(DyckAliasAnalysis, AliasAnalysis, "dyckaa",
 char DyckAliasAnalysis::ID = 0;
 
 const set<Value*>* DyckAliasAnalysis::getAliasSet(Value * ptr) const {
+	const_cast<DyckAliasAnalysis*>(this)->demand(ptr);
 	DyckVertex* v = dyck_graph->retrieveDyckVertex(ptr).first;
 	return (const set<Value*>*) v->getEquivalentSet();
 }
 
+DyckAliasAnalysis::AliasResult DyckAliasAnalysis::aliasRepresentatives(DyckVertex* VA, DyckVertex* VB) {
+	++NumRepAliasQueries;
+
+	// a value that is not in the graph, e.g. created by an optimization
+	// after the analysis, may alias any other value
+	if (VA == NULL || VB == NULL) {
+		return MayAlias;
+	}
+
+	if (VA == VB) {
+		return MayAlias;
+	}
+
+	// the result is symmetric, so (VA, VB) and (VB, VA) share one entry
+	if (VB < VA) {
+		std::swap(VA, VB);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(cacheMutex);
+		auto it = repAliasCache.find(std::make_pair(VA, VB));
+		if (it != repAliasCache.end()) {
+			++NumRepAliasCacheHits;
+			return it->second;
+		}
+	}
+
+	AliasResult ret = NoAlias;
+	if (isPartialAlias(VA, VB) || isPartialAlias(VB, VA)) {
+		ret = PartialAlias;
+	}
+
+	std::lock_guard<std::mutex> guard(cacheMutex);
+	repAliasCache[std::make_pair(VA, VB)] = ret;
+	return ret;
+}
+
 bool DyckAliasAnalysis::isPartialAlias(DyckVertex *v1, DyckVertex * v2) {
 	if (v1 == NULL || v2 == NULL)
 		return false;
@@ -233,6 +294,8 @@ void DyckAliasAnalysis::getEscapedPointersFrom(set<DyckVertex*>* ret, Value * fr
 		assert(!((Argument* ) from)->getParent()->empty());
 	}
 
+	this->demand(from);
+
 	set<DyckVertex*>& visited = *ret;
 	stack<DyckVertex*> workStack;
 
@@ -280,9 +343,22 @@ void DyckAliasAnalysis::getEscapedPointersTo(set<DyckVertex*>* ret, Function * f
 	assert(ret != NULL);
 	assert(func != NULL);
 
+	// the pointers escape from all the globals and the arguments of all the
+	// calls to func, which are only known if all the calls are resolved
+	this->demandAll();
+
+	{
+		std::lock_guard<std::mutex> guard(cacheMutex);
+		auto etIt = escapedToMap.find(func);
+		if (etIt != escapedToMap.end()) {
+			ret->insert(etIt->second->begin(), etIt->second->end());
+			return;
+		}
+	}
+
 	Module* module = func->getParent();
 
-	set<DyckVertex*>& visited = *ret;
+	set<DyckVertex*>* visited = new set<DyckVertex*>;
 	stack<DyckVertex*> workStack;
 
 	iplist<GlobalVariable>::iterator git = module->global_begin();
@@ -295,26 +371,23 @@ void DyckAliasAnalysis::getEscapedPointersTo(set<DyckVertex*>* ret, Function * f
 		git++;
 	}
 
-	for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
-		Function* f = iterF;
-		for (ilist_iterator<BasicBlock> iterB = f->getBasicBlockList().begin(); iterB != f->getBasicBlockList().end(); iterB++) {
-			for (ilist_iterator<Instruction> iterI = iterB->getInstList().begin(); iterI != iterB->getInstList().end(); iterI++) {
-				Instruction *rawInst = iterI;
-				if (isa<CallInst>(rawInst)) {
-					CallInst *inst = (CallInst*) rawInst; // all invokes are lowered to call
-					AliasResult ar = this->alias(func, inst->getCalledValue());
-					if (ar == MayAlias || ar == MustAlias) {
-						if (func->hasName() && func->getName() == "pthread_create") {
-							DyckVertex * rt = dyck_graph->retrieveDyckVertex(inst->getArgOperand(3)).first;
-							workStack.push(rt);
-						} else {
-							unsigned num = inst->getNumArgOperands();
-							for (unsigned i = 0; i < num; i++) {
-								DyckVertex * rt = dyck_graph->retrieveDyckVertex(inst->getArgOperand(i)).first;
-								workStack.push(rt);
-							}
-						}
-					}
+	// arguments of the calls to func
+	auto csIt = calleeCallSitesMap.find(func);
+	if (csIt != calleeCallSitesMap.end()) {
+		bool isPthreadCreate = func->hasName() && func->getName() == "pthread_create";
+
+		for (auto& call : csIt->second) {
+			CallSite cs(call);
+			if (isPthreadCreate) {
+				if (cs.arg_size() > 3) {
+					DyckVertex * rt = dyck_graph->retrieveDyckVertex(cs.getArgument(3)).first;
+					workStack.push(rt);
+				}
+			} else {
+				unsigned num = cs.arg_size();
+				for (unsigned i = 0; i < num; i++) {
+					DyckVertex * rt = dyck_graph->retrieveDyckVertex(cs.getArgument(i)).first;
+					workStack.push(rt);
 				}
 			}
 		}
@@ -325,29 +398,56 @@ void DyckAliasAnalysis::getEscapedPointersTo(set<DyckVertex*>* ret, Function * f
 		workStack.pop();
 
 		// have visited
-		if (visited.find(top) != visited.end()) {
+		if (visited->find(top) != visited->end()) {
 			continue;
 		}
 
-		visited.insert(top);
-
-		set<DyckVertex*> tars;
-		top->getOutVertices(&tars);
-		set<DyckVertex*>::iterator tit = tars.begin();
-		while (tit != tars.end()) {
-			// if it has not been visited
-			DyckVertex* dv = (*tit);
-			if (visited.find(dv) == visited.end()) {
-				workStack.push(dv);
+		visited->insert(top);
+
+		map<void*, set<DyckVertex*>*>& outVs = top->getOutVertices();
+		auto ovIt = outVs.begin();
+		while (ovIt != outVs.end()) {
+			set<DyckVertex*>::iterator tit = ovIt->second->begin();
+			while (tit != ovIt->second->end()) {
+				// if it has not been visited
+				DyckVertex* dv = (*tit);
+				if (visited->find(dv) == visited->end()) {
+					workStack.push(dv);
+				}
+				tit++;
 			}
-			tit++;
+			ovIt++;
 		}
 	}
+
+	ret->insert(visited->begin(), visited->end());
+
+	// another thread may have computed it at the same time
+	std::lock_guard<std::mutex> guard(cacheMutex);
+	if (!escapedToMap.insert(pair<Function*, set<DyckVertex*>*>(func, visited)).second) {
+		delete visited;
+	}
+}
+
+void DyckAliasAnalysis::addCallSite(Function* callee, Instruction* call) {
+	// implicit calls, e.g. those in pthread_create, have no call sites
+	if (call != NULL) {
+		calleeCallSitesMap[callee].insert(call);
+	}
+}
+
+void DyckAliasAnalysis::removeCallSite(Function* callee, Instruction* call) {
+	auto csIt = calleeCallSitesMap.find(callee);
+	if (call != NULL && csIt != calleeCallSitesMap.end()) {
+		csIt->second.erase(call);
+	}
 }
 
 void DyckAliasAnalysis::getPointstoObjects(std::set<Value*>& objects, Value* pointer) {
 	assert(pointer != nullptr);
 
+	this->demand(pointer);
+
 	DyckVertex * rt = dyck_graph->retrieveDyckVertex(pointer).first;
 	auto tars = rt->getOutVertices(DEREF_LABEL);
 	if (tars != nullptr && !tars->empty()) {
@@ -362,88 +462,117 @@ void DyckAliasAnalysis::getPointstoObjects(std::set<Value*>& objects, Value* poi
 }
 
 bool DyckAliasAnalysis::isDefaultMemAllocaFunction(Value* calledValue) {
-    if (isa<Function>(calledValue)) {
-        if(mem_allocas.count((Function*)calledValue)){
-            return true;
-        }
-    } else {
-        for (auto& func : mem_allocas) {
-            if (this->alias(calledValue, func)) {
-                return true;
-            }
-        }
-    }
-
-    return false;
+    return this->getAllocSiteIndex()->isAllocator(calledValue);
 }
 
-std::vector<Value*>* DyckAliasAnalysis::getDefaultPointstoMemAlloca(Value* ptr) {
+ArrayRef<Value*> DyckAliasAnalysis::getDefaultPointstoMemAlloca(Value* ptr) {
     assert(ptr->getType()->isPointerTy());
 
-    DyckVertex* v = dyck_graph->retrieveDyckVertex(ptr).first;
-    if (vertexMemAllocaMap.count(v)) {
-        return vertexMemAllocaMap[v];
+    AllocSiteIndex* index = this->getAllocSiteIndex();
+    DyckVertex* v = dyck_graph->findDyckVertex(ptr);
+    if (v == NULL) {
+        return ArrayRef<Value*>();
     }
+    return index->getSites(v);
+}
+
+AllocSiteIndex* DyckAliasAnalysis::getAllocSiteIndex() {
+    // the sites of a representative are complete only if all the calls are resolved
+    this->demandAll();
 
-    std::vector<Value*>* objects = new std::vector<Value*>;
-    vertexMemAllocaMap[v] = objects;
-
-    // find allocas in v self
-    auto aliases = (const set<Value*>*) v->getEquivalentSet();
-
-    for (auto& al : *aliases) {
-        if (isa<GlobalVariable>(al) || isa<Function>(al)) {
-            objects->push_back(al);
-        } else if (isa<AllocaInst>(al)) {
-            objects->push_back(al);
-        } else if (isa<CallInst>(al) || isa<InvokeInst>(al)) {
-            CallSite cs(al);
-            Value* calledValue = cs.getCalledValue();
-            if (isDefaultMemAllocaFunction(calledValue)) {
-                objects->push_back(al);
-            }
-        }
+    std::lock_guard<std::mutex> guard(cacheMutex);
+    if (alloc_sites == NULL) {
+        alloc_sites = new AllocSiteIndex(module, dyck_graph, mem_allocas);
     }
+    return alloc_sites;
+}
+
+void DyckAliasAnalysis::freeze() {
+	// queries cannot change the graph any more
+	this->demandAll();
+	dyck_graph->freeze();
+}
+
+void DyckAliasAnalysis::demand(const Value* v) {
+	if (demand_analyzer == NULL) {
+		return;
+	}
+
+	set<Value*> values;
+	values.insert(const_cast<Value*>(v));
+	if (demand_analyzer->demand_inter_procedure_analysis(&values)) {
+		this->invalidateCaches();
+	}
+}
+
+void DyckAliasAnalysis::demandAll() {
+	if (demand_analyzer == NULL) {
+		return;
+	}
+
+	// the summaries below query the escaped pointers, which demand all
+	AAAnalyzer* aaa = demand_analyzer;
+	demand_analyzer = NULL;
+	aaa->demand_inter_procedure_analysis(NULL);
+	delete aaa;
+	this->invalidateCaches();
+
+	// the final graph, with the resolved pointer calls
+	call_graph->build();
+	if (!NoModRefSummaries) {
+		this->computeModRefSummaries();
+	}
+
+	if (!this->callGraphPreserved()) {
+		delete this->call_graph;
+		this->call_graph = NULL;
+	}
+}
+
+void DyckAliasAnalysis::invalidateCaches() {
+	// representatives in the keys may have been merged and released
+	std::lock_guard<std::mutex> guard(cacheMutex);
+	repAliasCache.clear();
 
-    return objects;
+	for (auto& et : escapedToMap) {
+		delete et.second;
+	}
+	escapedToMap.clear();
 }
 
 bool DyckAliasAnalysis::callGraphPreserved() {
 	return PreserveCallGraph;
 }
 
+void DyckAliasAnalysis::preserveCallGraph() {
+	PreserveCallGraph = true;
+}
+
 DyckCallGraph* DyckAliasAnalysis::getCallGraph() {
 	assert(this->callGraphPreserved() && "Please add -preserve-dyck-callgraph option when using opt or canary.\n");
+	// the call graph is complete only if all the calls are resolved
+	this->demandAll();
 	return call_graph;
 }
 
 bool DyckAliasAnalysis::runOnModule(Module & M) {
 	InitializeAliasAnalysis(this);
+	module = &M;
 
-	{
-	   auto addAllocLikeFunc = [this, &M](const char* name) {
-	       if (Function* F = M.getFunction(name)) {
-	           this->mem_allocas.insert(F);
-	       }
-	   };
-	   addAllocLikeFunc("malloc");
-	   addAllocLikeFunc("calloc");
-	   addAllocLikeFunc("realloc");
-	   addAllocLikeFunc("valloc");
-	   addAllocLikeFunc("reallocf");
-	   addAllocLikeFunc("strdup");
-	   addAllocLikeFunc("strndup");
-	   addAllocLikeFunc("_Znaj");
-	   addAllocLikeFunc("_ZnajRKSt9nothrow_t");
-	   addAllocLikeFunc("_Znam");
-	   addAllocLikeFunc("_ZnamRKSt9nothrow_t");
-	   addAllocLikeFunc("_Znwj");
-	   addAllocLikeFunc("_ZnwjRKSt9nothrow_t");
-	   addAllocLikeFunc("_Znwm");
-	   addAllocLikeFunc("_ZnwmRKSt9nothrow_t");
-	}
-
-	AAAnalyzer* aaa = new AAAnalyzer(&M, this, dyck_graph, call_graph);
+	for (auto& file : LibSpecFiles) {
+		std::string error;
+		if (!lib_spec->load(file, error)) {
+			errs() << "ERROR: " << error << "\n";
+			exit(1);
+		}
+	}
+	lib_spec->bind(M);
+	mem_allocas.insert(lib_spec->getAllocators().begin(), lib_spec->getAllocators().end());
+
+	// printing the call graph or alias sets needs the whole program
+	bool demand = DemandDriven && !DotCallGraph && !CountFP && !PrintAliasSetInformation && ExportSummary.empty()
+			&& ExportAllocSites.empty();
+	AAAnalyzer* aaa = new AAAnalyzer(&M, this, dyck_graph, call_graph, demand);
 
 	/// step 1: intra-procedure analysis
 	aaa->start_intra_procedure_analysis();
@@ -452,6 +581,13 @@ bool DyckAliasAnalysis::runOnModule(Module & M) {
 	outs() << "Done!\n\n";
 	aaa->end_intra_procedure_analysis();
 
+	if (demand) {
+		// step 2 is done when the analysis is queried, see demand()
+		outs() << "Inter-procedure analysis is done on demand.\n\n";
+		demand_analyzer = aaa;
+		return false;
+	}
+
 	/// step 2: inter-procedure analysis
 	aaa->start_inter_procedure_analysis();
 	outs() << "Start inter-procedure analysis...";
@@ -459,6 +595,15 @@ bool DyckAliasAnalysis::runOnModule(Module & M) {
 	outs() << "\nDone!\n\n";
 	aaa->end_inter_procedure_analysis();
 
+	// the final graph, with the resolved pointer calls
+	call_graph->build();
+
+	if (!NoModRefSummaries) {
+		outs() << "Computing mod/ref summaries...\n";
+		this->computeModRefSummaries();
+		outs() << "Done!\n\n";
+	}
+
 	/* call graph */
 	if (DotCallGraph) {
 		outs() << "Printing call graph...\n";
@@ -472,6 +617,22 @@ bool DyckAliasAnalysis::runOnModule(Module & M) {
 		outs() << "Done!\n\n";
 	}
 
+	if (!ExportSummary.empty()) {
+		outs() << "Exporting the module summary...\n";
+		this->exportSummary(M, ExportSummary);
+		outs() << "Done!\n\n";
+	}
+
+	if (!ExportAllocSites.empty()) {
+		outs() << "Exporting the allocation sites...\n";
+		AllocSiteIndex* index = this->getAllocSiteIndex();
+		outs() << "# Allocation sites: " << index->numSites() << " of " << index->numRepresentatives() << " alias sets\n";
+		if (!index->save(ExportAllocSites)) {
+			errs() << "ERROR: cannot write " << ExportAllocSites << "\n";
+		}
+		outs() << "Done!\n\n";
+	}
+
 	delete aaa;
 	aaa = NULL;
 
@@ -488,9 +649,366 @@ bool DyckAliasAnalysis::runOnModule(Module & M) {
 
 	DEBUG_WITH_TYPE("validate-dyckgraph", dyck_graph->validation(__FILE__, __LINE__));
 
+	// the graph does not change any more from now on
+	repAliasCache.clear();
+
+	return false;
+}
+
+/// Add the representatives reachable by the offset edges, i.e. those
+/// partially aliased with the given ones, see isPartialAlias.
+static void closeOverOffsets(vector<DyckVertex*>& reps) {
+	set<DyckVertex*> visited(reps.begin(), reps.end());
+	for (unsigned i = 0; i < reps.size(); i++) {
+		DyckVertex* top = reps[i];
+		for (auto label : top->getOutLabels()) {
+			if (!((EdgeLabel*) label)->isLabelTy(EdgeLabel::OFFSET_TYPE)) {
+				continue;
+			}
+			for (auto tar : *top->getOutVertices(label)) {
+				if (visited.insert(tar).second) {
+					reps.push_back(tar);
+				}
+			}
+		}
+	}
+	sort(reps.begin(), reps.end());
+	reps.erase(unique(reps.begin(), reps.end()), reps.end());
+}
+
+/// Whether the closed and sorted reps contain v, or any representative
+/// partially aliased with v.
+static bool mayAccess(const vector<DyckVertex*>& reps, DyckVertex* v) {
+	if (reps.empty()) {
+		return false;
+	}
+
+	set<DyckVertex*> visited;
+	vector<DyckVertex*> workStack(1, v);
+	while (!workStack.empty()) {
+		DyckVertex* top = workStack.back();
+		workStack.pop_back();
+		if (!visited.insert(top).second) {
+			continue;
+		}
+		if (binary_search(reps.begin(), reps.end(), top)) {
+			return true;
+		}
+
+		for (auto label : top->getOutLabels()) {
+			if (((EdgeLabel*) label)->isLabelTy(EdgeLabel::OFFSET_TYPE)) {
+				set<DyckVertex*>* tars = top->getOutVertices(label);
+				workStack.insert(workStack.end(), tars->begin(), tars->end());
+			}
+		}
+	}
 	return false;
 }
 
+void DyckAliasAnalysis::computeModRefSummaries() {
+	// the summaries of the pointer calls are computed after all the
+	// functions, since their callees may be in the same SCC as the callers
+	vector<pair<Instruction*, PointerCall*> > pointerCalls;
+
+	for (unsigned k = 0; k < call_graph->getNumSCCs(); k++) {
+		ModRefSummary* s = new ModRefSummary;
+		modRefSummaryList.push_back(s);
+		for (auto i : call_graph->getSCC(k)) {
+			Function* f = call_graph->getNode(i)->getLLVMFunction();
+			if (!f->empty()) {
+				modRefSummaries[f] = s;
+			}
+		}
+
+		for (auto i : call_graph->getSCC(k)) {
+			DyckCallGraphNode* df = call_graph->getNode(i);
+			Function* f = df->getLLVMFunction();
+			for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+				Instruction* inst = &*it;
+				switch (inst->getOpcode()) {
+				case Instruction::Load:
+					// atomics may synchronize with other threads, which
+					// then access any memory
+					if (((LoadInst*) inst)->isAtomic()) {
+						s->modAll = s->refAll = true;
+					} else {
+						this->addPointerModRef(s, ((LoadInst*) inst)->getPointerOperand(), false, true);
+					}
+					break;
+				case Instruction::Store:
+					if (((StoreInst*) inst)->isAtomic()) {
+						s->modAll = s->refAll = true;
+					} else {
+						this->addPointerModRef(s, ((StoreInst*) inst)->getPointerOperand(), true, false);
+					}
+					break;
+				case Instruction::AtomicCmpXchg:
+				case Instruction::AtomicRMW:
+				case Instruction::Fence:
+					s->modAll = s->refAll = true;
+					break;
+				case Instruction::VAArg:
+					this->addPointerModRef(s, ((VAArgInst*) inst)->getPointerOperand(), true, true);
+					break;
+				case Instruction::Call:
+				case Instruction::Invoke: {
+					CallSite cs(inst);
+					Call* c = df->getCall(inst);
+					if (c == NULL) {
+						// intrinsics, and inline asm whose accesses are unknown
+						Function* callee = dyn_cast<Function>(cs.getCalledValue());
+						this->addCallModRef(s, cs, callee != NULL && callee->isIntrinsic() ? callee : NULL);
+					} else if (isa<Function>(c->calledValue)) {
+						Function* callee = (Function*) c->calledValue;
+						this->addCallModRef(s, cs, callee);
+
+						// the summary of a library call depends on its arguments
+						const LibrarySpec::FunctionSpec* spec = lib_spec->lookup(callee, cs.arg_size());
+						if (callee->empty() && spec != NULL && spec->knownAccesses) {
+							ModRefSummary* cs_s = new ModRefSummary;
+							modRefSummaryList.push_back(cs_s);
+							this->addCallModRef(cs_s, cs, callee);
+							closeOverOffsets(cs_s->mods);
+							closeOverOffsets(cs_s->refs);
+							modRefSummaries[inst] = cs_s;
+						}
+					} else {
+						PointerCall* pc = (PointerCall*) c;
+						if (pc->mayAliasedCallees.empty()) {
+							s->modAll = s->refAll = true;
+							s->allocates = true;
+						}
+						for (auto callee : pc->mayAliasedCallees) {
+							this->addCallModRef(s, cs, callee);
+						}
+						pointerCalls.push_back(make_pair(inst, pc));
+					}
+				}
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		closeOverOffsets(s->mods);
+		closeOverOffsets(s->refs);
+	}
+
+	for (auto& pit : pointerCalls) {
+		PointerCall* pc = pit.second;
+		if (pc->mayAliasedCallees.empty()) {
+			continue;
+		}
+
+		ModRefSummary* s = new ModRefSummary;
+		modRefSummaryList.push_back(s);
+		CallSite cs(pit.first);
+		for (auto callee : pc->mayAliasedCallees) {
+			this->addCallModRef(s, cs, callee);
+		}
+		closeOverOffsets(s->mods);
+		closeOverOffsets(s->refs);
+		modRefSummaries[pit.first] = s;
+	}
+
+	// all the memory covers the representatives
+	for (auto s : modRefSummaryList) {
+		if (s->modAll) {
+			s->mods.clear();
+		}
+		if (s->refAll) {
+			s->refs.clear();
+		}
+	}
+}
+
+void DyckAliasAnalysis::addCallModRef(ModRefSummary* s, CallSite cs, Function* callee) {
+	if (callee == NULL) {
+		s->modAll = s->refAll = true;
+		s->allocates = true;
+		return;
+	}
+
+	if (mem_allocas.count(callee)) {
+		s->allocates = true;
+	}
+
+	if (!callee->empty()) {
+		// a callee in the same SCC shares the summary
+		auto it = modRefSummaries.find(callee);
+		if (it == modRefSummaries.end()) {
+			s->modAll = s->refAll = true;
+			s->allocates = true;
+		} else if (it->second != s) {
+			ModRefSummary* fs = it->second;
+			s->modAll |= fs->modAll;
+			s->refAll |= fs->refAll;
+			s->allocates |= fs->allocates;
+			s->mods.insert(s->mods.end(), fs->mods.begin(), fs->mods.end());
+			s->refs.insert(s->refs.end(), fs->refs.begin(), fs->refs.end());
+		}
+		return;
+	}
+
+	// a library function accesses what its spec says, if it says so
+	const LibrarySpec::FunctionSpec* spec = lib_spec->lookup(callee, cs.arg_size());
+	if (spec != NULL && spec->knownAccesses) {
+		for (auto& r : spec->relations) {
+			if ((r.kind == LibrarySpec::MOD || r.kind == LibrarySpec::REF) && r.x <= cs.arg_size()) {
+				this->addPointerModRef(s, cs.getArgument(r.x - 1), r.kind == LibrarySpec::MOD, r.kind == LibrarySpec::REF);
+			}
+		}
+		return;
+	}
+
+	// otherwise, what the chained analyses know, e.g. from the attributes
+	ModRefBehavior mrb = AliasAnalysis::getModRefBehavior(callee);
+	if (doesNotAccessMemory(mrb)) {
+		return;
+	}
+
+	bool mod = !onlyReadsMemory(mrb);
+	if (!onlyAccessesArgPointees(mrb)) {
+		s->modAll |= mod;
+		s->refAll = true;
+		// an unknown callee may allocate, unless it cannot write anything
+		s->allocates |= mod;
+		return;
+	}
+
+	for (unsigned i = 0; i < cs.arg_size(); i++) {
+		Value* arg = cs.getArgument(i);
+		if (arg->getType()->isPointerTy()) {
+			this->addPointerModRef(s, arg, mod, true);
+		} else if (arg->getType()->isVectorTy() && arg->getType()->getVectorElementType()->isPointerTy()) {
+			s->modAll |= mod;
+			s->refAll = true;
+		}
+	}
+}
+
+void DyckAliasAnalysis::addPointerModRef(ModRefSummary* s, Value* ptr, bool mod, bool ref) {
+	DyckVertex* rep = dyck_graph->findDyckVertex(ptr);
+	if (rep == NULL) {
+		s->modAll |= mod;
+		s->refAll |= ref;
+		return;
+	}
+
+	if (mod) {
+		s->mods.push_back(rep);
+	}
+	if (ref) {
+		s->refs.push_back(rep);
+	}
+}
+
+const DyckAliasAnalysis::ModRefSummary* DyckAliasAnalysis::getModRefSummary(ImmutableCallSite CS) {
+	// the summaries are computed after all the calls are resolved, i.e. not
+	// in the demand-driven mode until demandAll()
+	if (modRefSummaries.empty()) {
+		return NULL;
+	}
+
+	auto it = modRefSummaries.find(CS.getInstruction());
+	if (it != modRefSummaries.end()) {
+		return it->second;
+	}
+
+	const Function* callee = dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+	if (callee == NULL) {
+		return NULL;
+	}
+	it = modRefSummaries.find(callee);
+	return it == modRefSummaries.end() ? NULL : it->second;
+}
+
+AliasAnalysis::ModRefResult DyckAliasAnalysis::getModRefInfo(ImmutableCallSite CS, const Location &Loc) {
+	ModRefResult ret;
+	{
+		std::lock_guard<std::recursive_mutex> guard(chainMutex);
+		ret = AliasAnalysis::getModRefInfo(CS, Loc);
+	}
+	if (ret == NoModRef) {
+		return ret;
+	}
+
+	// a value created after the analysis, e.g. by an optimization, is not
+	// in the graph
+	const ModRefSummary* s = this->getModRefSummary(CS);
+	DyckVertex* v = dyck_graph->findDyckVertex(const_cast<Value*>(Loc.Ptr));
+	if (s == NULL || v == NULL) {
+		return ret;
+	}
+
+	unsigned mask = NoModRef;
+	if (s->modAll || mayAccess(s->mods, v)) {
+		mask |= Mod;
+	}
+	if (s->refAll || mayAccess(s->refs, v)) {
+		mask |= Ref;
+	}
+	if ((ret & mask) != ret) {
+		++NumModRefNarrowed;
+	}
+	return ModRefResult(ret & mask);
+}
+
+AliasAnalysis::ModRefBehavior DyckAliasAnalysis::getModRefBehavior(ImmutableCallSite CS) {
+	ModRefBehavior ret;
+	{
+		std::lock_guard<std::recursive_mutex> guard(chainMutex);
+		ret = AliasAnalysis::getModRefBehavior(CS);
+	}
+
+	const ModRefSummary* s = this->getModRefSummary(CS);
+	return s == NULL ? ret : ModRefBehavior(ret & s->getBehavior());
+}
+
+AliasAnalysis::ModRefBehavior DyckAliasAnalysis::getModRefBehavior(const Function *F) {
+	ModRefBehavior ret;
+	{
+		std::lock_guard<std::recursive_mutex> guard(chainMutex);
+		ret = AliasAnalysis::getModRefBehavior(F);
+	}
+
+	auto it = modRefSummaries.find(F);
+	return it == modRefSummaries.end() ? ret : ModRefBehavior(ret & it->second->getBehavior());
+}
+
+void DyckAliasAnalysis::deleteValue(Value *V) {
+	modRefSummaries.erase(V);
+	// a new value may be allocated at the same address
+	dyck_graph->unbindDyckVertex(V);
+
+	std::lock_guard<std::recursive_mutex> guard(chainMutex);
+	AliasAnalysis::deleteValue(V);
+}
+
+void DyckAliasAnalysis::copyValue(Value *From, Value *To) {
+	// e.g. a call cloned by inlining accesses at most what the original one
+	// accesses, since the parameters of the callee alias all the actuals
+	auto it = modRefSummaries.find(From);
+	if (it != modRefSummaries.end()) {
+		ModRefSummary* s = it->second;
+		modRefSummaries[To] = s;
+	} else {
+		modRefSummaries.erase(To);
+	}
+
+	// To is equivalent to From; a frozen graph cannot bind values, so To is
+	// left without a vertex, which may alias anything
+	dyck_graph->unbindDyckVertex(To);
+	DyckVertex* v = dyck_graph->findDyckVertex(From);
+	if (v != NULL && !dyck_graph->isFrozen()) {
+		dyck_graph->bindDyckVertex(To, v);
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(chainMutex);
+	AliasAnalysis::copyValue(From, To);
+}
+
 void DyckAliasAnalysis::printAliasSetInformation(Module& M) {
 	/*if (InterAAEval)*/
 	{
@@ -676,6 +1194,182 @@ void DyckAliasAnalysis::printAliasSetInformation(Module& M) {
 	}
 }
 
+void DyckAliasAnalysis::exportSummary(Module& M, const std::string& file) {
+	ModuleSummary summary;
+	summary.module = M.getModuleIdentifier();
+
+	// values are numbered in the order of the module, so that the summary
+	// does not depend on the addresses of the objects
+	map<Value*, unsigned> valueNums;
+	for (auto git = M.global_begin(); git != M.global_end(); ++git) {
+		valueNums.insert(make_pair(&*git, (unsigned) valueNums.size()));
+	}
+	for (auto fit = M.begin(); fit != M.end(); ++fit) {
+		valueNums.insert(make_pair(&*fit, (unsigned) valueNums.size()));
+		for (auto ait = fit->arg_begin(); ait != fit->arg_end(); ++ait) {
+			valueNums.insert(make_pair(&*ait, (unsigned) valueNums.size()));
+		}
+		for (inst_iterator it = inst_begin(&*fit); it != inst_end(&*fit); ++it) {
+			valueNums.insert(make_pair(&*it, (unsigned) valueNums.size()));
+		}
+	}
+	auto valueNum = [&](Value* v) {
+		auto it = valueNums.find(v);
+		return it == valueNums.end() ? (unsigned) valueNums.size() : it->second;
+	};
+
+	// the vertices that other modules can see are numbered first, and then
+	// the vertices reachable from them
+	map<DyckVertex*, unsigned> indices;
+	vector<DyckVertex*> vertices;
+	auto vertexOf = [&](DyckVertex* rep) {
+		auto it = indices.find(rep);
+		if (it != indices.end()) {
+			return it->second;
+		}
+		indices[rep] = vertices.size();
+		vertices.push_back(rep);
+		return (unsigned) vertices.size() - 1;
+	};
+	auto vertexOfValue = [&](Value* v) {
+		return v == NULL ? ModuleSummary::NONE : vertexOf(dyck_graph->retrieveDyckVertex(v).first);
+	};
+	auto functionName = [&](Function* f) {
+		return f->hasLocalLinkage() ? summary.module + ":" + f->getName().str() : f->getName().str();
+	};
+
+	for (auto git = M.global_begin(); git != M.global_end(); ++git) {
+		if (!git->hasLocalLinkage() && git->hasName()) {
+			summary.globals.push_back(make_pair(git->getName().str(), vertexOfValue(&*git)));
+		}
+	}
+	for (auto git = M.alias_begin(); git != M.alias_end(); ++git) {
+		if (!git->hasLocalLinkage() && git->hasName()) {
+			summary.globals.push_back(make_pair(git->getName().str(), vertexOfValue(&*git)));
+		}
+	}
+
+	for (auto fit = M.begin(); fit != M.end(); ++fit) {
+		Function* f = &*fit;
+		if (f->isIntrinsic() || (f->hasLocalLinkage() && !f->hasAddressTaken())) {
+			continue;
+		}
+
+		ModuleSummary::FunctionInfo info;
+		info.name = functionName(f);
+		info.defined = !f->empty();
+		info.varArg = f->isVarArg();
+		info.vertex = f->hasAddressTaken() ? vertexOfValue(f) : ModuleSummary::NONE;
+		if (info.defined) {
+			DyckCallGraphNode* df = call_graph->getOrInsertFunction(f);
+			for (auto ait = f->arg_begin(); ait != f->arg_end(); ++ait) {
+				info.params.push_back(vertexOfValue(&*ait));
+			}
+
+			vector<Value*> rets(df->getReturns().begin(), df->getReturns().end());
+			sort(rets.begin(), rets.end(), [&](Value* a, Value* b) {
+				return valueNum(a) < valueNum(b);
+			});
+			for (auto ret : rets) {
+				info.rets.push_back(vertexOfValue(ret));
+			}
+			for (auto vaarg : df->getVAArgs()) {
+				info.vaargs.push_back(vertexOfValue(vaarg));
+			}
+		}
+		summary.functions.push_back(info);
+	}
+
+	// the calls whose callees may be defined in other modules
+	for (auto fit = M.begin(); fit != M.end(); ++fit) {
+		Function* f = &*fit;
+		if (f->isIntrinsic()) {
+			continue;
+		}
+		DyckCallGraphNode* df = call_graph->getOrInsertFunction(f);
+
+		// pointer calls are marked by the second ones
+		vector<pair<Call*, bool> > calls;
+		for (auto c : df->getCommonCalls()) {
+			Function* callee = (Function*) c->calledValue;
+			if (callee->empty() && !callee->isIntrinsic()) {
+				calls.push_back(make_pair(c, false));
+			}
+		}
+		for (auto c : df->getPointerCalls()) {
+			calls.push_back(make_pair(c, true));
+		}
+		sort(calls.begin(), calls.end(), [&](const pair<Call*, bool>& a, const pair<Call*, bool>& b) {
+			Call* ca = a.first;
+			Call* cb = b.first;
+			unsigned na = valueNum(ca->instruction ? ca->instruction : ca->calledValue);
+			unsigned nb = valueNum(cb->instruction ? cb->instruction : cb->calledValue);
+			if (na != nb) {
+				return na < nb;
+			}
+			return (ca->args.empty() ? 0 : valueNum(ca->args[0])) < (cb->args.empty() ? 0 : valueNum(cb->args[0]));
+		});
+
+		for (auto& cit : calls) {
+			Call* c = cit.first;
+			ModuleSummary::CallInfo info;
+			info.caller = functionName(f);
+			info.ret = vertexOfValue(c->instruction);
+			for (auto arg : c->args) {
+				info.args.push_back(vertexOfValue(arg));
+			}
+
+			if (cit.second) {
+				info.calledValue = vertexOfValue(c->calledValue);
+				for (auto callee : ((PointerCall*) c)->mayAliasedCallees) {
+					info.callees.push_back(functionName(callee));
+				}
+				sort(info.callees.begin(), info.callees.end());
+			} else {
+				info.callee = functionName((Function*) c->calledValue);
+				info.calledValue = ModuleSummary::NONE;
+			}
+			summary.calls.push_back(info);
+		}
+	}
+
+	// the vertices reachable from the above, with their edges
+	for (unsigned i = 0; i < vertices.size(); i++) {
+		vector<ModuleSummary::Edge> edges;
+		for (auto& it : vertices[i]->getOutVertices()) {
+			EdgeLabel* label = (EdgeLabel*) it.first;
+			ModuleSummary::Edge e;
+			e.from = i;
+			if (label->isLabelTy(EdgeLabel::OFFSET_TYPE)) {
+				e.kind = 'o';
+				e.num = ((PointerOffsetEdgeLabel*) label)->getOffsetBytes();
+			} else if (label->isLabelTy(EdgeLabel::INDEX_TYPE)) {
+				e.kind = 'i';
+				e.num = ((FieldIndexEdgeLabel*) label)->getFieldIndex();
+			} else {
+				e.kind = 'd';
+				e.num = 0;
+			}
+			for (auto target : *it.second) {
+				e.to = vertexOf(target);
+				edges.push_back(e);
+			}
+		}
+		sort(edges.begin(), edges.end(), [](const ModuleSummary::Edge& a, const ModuleSummary::Edge& b) {
+			return a.kind != b.kind ? a.kind < b.kind : a.num < b.num;
+		});
+		summary.edges.insert(summary.edges.end(), edges.begin(), edges.end());
+	}
+	summary.vertexNum = vertices.size();
+
+	if (!summary.save(file)) {
+		errs() << "ERROR: cannot write the module summary into " << file << "\n";
+		return;
+	}
+	outs() << "# Summary: " << summary.vertexNum << " vertices, " << summary.functions.size() << " functions, "
+			<< summary.calls.size() << " calls\n";
+}
+
 ModulePass *createDyckAliasAnalysisPass() {
 	return new DyckAliasAnalysis();
 }
@@ -0,0 +1,446 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "DyckAA/FunctionSummary.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <set>
+
+// bump it if the analysis or the format changes, so that old summaries
+// are not used any more
+#define SUMMARY_VERSION 1
+
+FunctionSummary::FunctionSummary(Function* f) :
+		func(f), vertexNum(0), valid(true), current(0) {
+	for (auto ait = f->arg_begin(); ait != f->arg_end(); ++ait) {
+		localIndices[&*ait] = args.size();
+		args.push_back(&*ait);
+	}
+	for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+		localIndices[&*it] = insts.size();
+		insts.push_back(&*it);
+	}
+}
+
+/// Print a type, and collect the named structs in it, whose bodies are
+/// printed at the end.
+static void printType(raw_ostream& os, Type* ty, vector<StructType*>& structs, std::set<StructType*>& visited) {
+	ty->print(os);
+	vector<Type*> worklist(1, ty);
+	while (!worklist.empty()) {
+		Type* t = worklist.back();
+		worklist.pop_back();
+		if (StructType* st = dyn_cast<StructType>(t)) {
+			if (st->hasName() && !visited.insert(st).second) {
+				continue;
+			}
+			if (st->hasName()) {
+				structs.push_back(st);
+			}
+		}
+		worklist.insert(worklist.end(), t->subtype_begin(), t->subtype_end());
+	}
+}
+
+uint64_t FunctionSummary::hash(Function* f) {
+	std::string buf;
+	raw_string_ostream os(buf);
+
+	vector<StructType*> structs;
+	std::set<StructType*> visited;
+	map<Value*, unsigned> locals;
+	map<BasicBlock*, unsigned> blocks;
+
+	os << "v" << SUMMARY_VERSION << " " << f->getName() << " ";
+	printType(os, f->getType(), structs, visited);
+	unsigned localNum = 0, blockNum = 0;
+	for (auto ait = f->arg_begin(); ait != f->arg_end(); ++ait) {
+		locals[&*ait] = localNum++;
+	}
+	for (auto bit = f->begin(); bit != f->end(); ++bit) {
+		blocks[&*bit] = blockNum++;
+		for (auto iit = bit->begin(); iit != bit->end(); ++iit) {
+			locals[&*iit] = localNum++;
+		}
+	}
+
+	for (inst_iterator it = inst_begin(f); it != inst_end(f); ++it) {
+		Instruction* inst = &*it;
+		os << "\n" << inst->getOpcodeName() << " ";
+		printType(os, inst->getType(), structs, visited);
+
+		for (unsigned i = 0; i < inst->getNumOperands(); i++) {
+			Value* op = inst->getOperand(i);
+			os << ", ";
+			if (locals.count(op)) {
+				os << "%" << locals[op];
+			} else if (isa<BasicBlock>(op)) {
+				os << "label " << blocks[(BasicBlock*) op];
+			} else if (isa<MetadataAsValue>(op)) {
+				// debug information does not matter
+				os << "metadata";
+			} else if (isa<GlobalValue>(op)) {
+				printType(os, op->getType(), structs, visited);
+				os << " @" << op->getName();
+				// library functions are handled when they are declarations
+				if (isa<Function>(op) && ((Function*) op)->empty()) {
+					os << " declare";
+				}
+			} else if (isa<InlineAsm>(op)) {
+				InlineAsm* ia = (InlineAsm*) op;
+				os << "asm \"" << ia->getAsmString() << "\" \"" << ia->getConstraintString() << "\"";
+			} else {
+				// constants print the globals in them by names
+				printType(os, op->getType(), structs, visited);
+				os << " " << *op;
+			}
+		}
+
+		if (isa<ExtractValueInst>(inst)) {
+			for (auto idx : ((ExtractValueInst*) inst)->getIndices()) {
+				os << " " << idx;
+			}
+		} else if (isa<InsertValueInst>(inst)) {
+			for (auto idx : ((InsertValueInst*) inst)->getIndices()) {
+				os << " " << idx;
+			}
+		} else if (isa<AtomicRMWInst>(inst)) {
+			os << " " << ((AtomicRMWInst*) inst)->getOperation();
+		}
+	}
+
+	// bodies of the named structs, including those found in the bodies
+	for (unsigned i = 0; i < structs.size(); i++) {
+		StructType* st = structs[i];
+		os << "\n%" << st->getName() << " = {";
+		for (unsigned j = 0; j < st->getNumElements(); j++) {
+			os << " ";
+			printType(os, st->getElementType(j), structs, visited);
+		}
+		os << " }";
+	}
+	os.flush();
+
+	// FNV-1a, which does not change across runs
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < buf.size(); i++) {
+		h ^= (unsigned char) buf[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/* ************************************************************************
+ * Recording
+ * ************************************************************************/
+
+void FunctionSummary::setCurrentInstruction(Instruction* inst) {
+	current = localIndices[inst];
+}
+
+FunctionSummary::Ref FunctionSummary::value(Value* v) {
+	Ref r = none();
+	if (v == NULL) {
+		return r;
+	}
+
+	auto it = localIndices.find(v);
+	if (it != localIndices.end()) {
+		r.kind = isa<Argument>(v) ? 'a' : 'i';
+		r.idx = it->second;
+		return r;
+	}
+
+	// others, e.g. constants, are operands of the current instruction
+	Instruction* inst = insts.empty() ? NULL : insts[current];
+	for (unsigned i = 0; inst != NULL && i < inst->getNumOperands(); i++) {
+		if (inst->getOperand(i) == v) {
+			r.kind = 'o';
+			r.idx = current;
+			r.opnd = i;
+			return r;
+		}
+	}
+
+	valid = false;
+	return r;
+}
+
+FunctionSummary::Ref FunctionSummary::vertex(DyckVertex* v) {
+	Ref r = none();
+	if (v == NULL) {
+		return r;
+	}
+
+	auto it = vertexIndices.find(v);
+	if (it == vertexIndices.end()) {
+		// not returned by a recorded op
+		valid = false;
+		return r;
+	}
+	r.kind = 'v';
+	r.idx = it->second;
+	return r;
+}
+
+void FunctionSummary::record(OpKind kind, long num, const vector<Ref>& refs, DyckVertex* ret) {
+	Op op;
+	op.kind = kind;
+	op.num = num;
+	op.refs = refs;
+	ops.push_back(op);
+
+	if (ret != NULL) {
+		vertexIndices[ret] = vertexNum++;
+	}
+}
+
+void FunctionSummary::record(OpKind kind, const vector<std::string>& names, const vector<Ref>& refs) {
+	for (auto& name : names) {
+		// looked up by names when replayed
+		if (name.empty()) {
+			valid = false;
+		}
+	}
+
+	Op op;
+	op.kind = kind;
+	op.num = 0;
+	op.names = names;
+	op.refs = refs;
+	ops.push_back(op);
+}
+
+void FunctionSummary::forget(DyckVertex* x, DyckVertex* y) {
+	vertexIndices.erase(x);
+	vertexIndices.erase(y);
+}
+
+/* ************************************************************************
+ * Replaying
+ * ************************************************************************/
+
+Value* FunctionSummary::getValue(const Ref& r) {
+	switch (r.kind) {
+	case 'a':
+		return args[r.idx];
+	case 'i':
+		return insts[r.idx];
+	case 'o':
+		return insts[r.idx]->getOperand(r.opnd);
+	default:
+		return NULL;
+	}
+}
+
+/* ************************************************************************
+ * Saving and loading
+ *
+ *     dyck-summary <version> <hash>
+ *     <vertices> <ops>
+ *     <kind> <num> <names> <len>:<name>... <refs> <ref>...
+ *
+ * where a ref is a3, i12, o12.1, v7 or n.
+ * ************************************************************************/
+
+bool FunctionSummary::save(const std::string& file) {
+	// written into a temporary file first, so that a crash or another
+	// canary saving the same summary never leaves a broken one
+	char tmp[32];
+	snprintf(tmp, sizeof (tmp), ".%d.tmp", (int) getpid());
+	std::string tmpfile = file + tmp;
+
+	FILE* fp = fopen(tmpfile.c_str(), "w");
+	if (!fp) {
+		return false;
+	}
+
+	fprintf(fp, "dyck-summary %d %016llx\n", SUMMARY_VERSION, (unsigned long long) hash(func));
+	fprintf(fp, "%u %lu\n", vertexNum, (unsigned long) ops.size());
+	for (auto& op : ops) {
+		fprintf(fp, "%d %ld %lu", (int) op.kind, op.num, (unsigned long) op.names.size());
+		for (auto& name : op.names) {
+			fprintf(fp, " %lu:", (unsigned long) name.size());
+			fwrite(name.data(), 1, name.size(), fp);
+		}
+		fprintf(fp, " %lu", (unsigned long) op.refs.size());
+		for (auto& r : op.refs) {
+			if (r.kind == 'n') {
+				fprintf(fp, " n");
+			} else if (r.kind == 'o') {
+				fprintf(fp, " o%u.%u", r.idx, r.opnd);
+			} else {
+				fprintf(fp, " %c%u", r.kind, r.idx);
+			}
+		}
+		fprintf(fp, "\n");
+	}
+
+	bool ok = !ferror(fp);
+	ok = fclose(fp) == 0 && ok;
+	if (!ok || rename(tmpfile.c_str(), file.c_str()) != 0) {
+		remove(tmpfile.c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool readRef(FILE* fp, FunctionSummary::Ref& r) {
+	char kind;
+	if (fscanf(fp, " %c", &kind) != 1) {
+		return false;
+	}
+
+	r = FunctionSummary::none();
+	r.kind = kind;
+	switch (kind) {
+	case 'n':
+		return true;
+	case 'o':
+		return fscanf(fp, "%u.%u", &r.idx, &r.opnd) == 2;
+	case 'a':
+	case 'i':
+	case 'v':
+		return fscanf(fp, "%u", &r.idx) == 1;
+	default:
+		return false;
+	}
+}
+
+bool FunctionSummary::load(const std::string& file) {
+	FILE* fp = fopen(file.c_str(), "r");
+	if (!fp) {
+		return false;
+	}
+
+	Module* module = func->getParent();
+	vector<Op> loaded;
+	unsigned loadedVertexNum = 0, vertices = 0;
+	unsigned long opNum = 0;
+	int version;
+	unsigned long long h;
+
+	bool ok = fscanf(fp, "dyck-summary %d %llx %u %lu", &version, &h, &loadedVertexNum, &opNum) == 4;
+	ok = ok && version == SUMMARY_VERSION && h == hash(func);
+
+	for (unsigned long i = 0; ok && i < opNum; i++) {
+		Op op;
+		int kind;
+		unsigned long nameNum, refNum;
+		ok = fscanf(fp, "%d %ld %lu", &kind, &op.num, &nameNum) == 3 && kind >= 0 && kind < OP_KIND_NUM && nameNum <= 2;
+		op.kind = (OpKind) kind;
+
+		for (unsigned long j = 0; ok && j < nameNum; j++) {
+			unsigned long len;
+			ok = fscanf(fp, " %lu:", &len) == 1 && len < 4096;
+			if (ok) {
+				std::string name(len, '\0');
+				ok = fread(&name[0], 1, len, fp) == len && module->getFunction(name) != NULL;
+				op.names.push_back(name);
+			}
+		}
+
+		ok = ok && fscanf(fp, "%lu", &refNum) == 1 && refNum <= insts.size() + 2;
+		for (unsigned long j = 0; ok && j < refNum; j++) {
+			Ref r;
+			ok = readRef(fp, r);
+			// every reference must be in the function, and a vertex must
+			// be returned by an earlier op
+			if (r.kind == 'a') {
+				ok = ok && r.idx < args.size();
+			} else if (r.kind == 'i') {
+				ok = ok && r.idx < insts.size();
+			} else if (r.kind == 'o') {
+				ok = ok && r.idx < insts.size() && r.opnd < insts[r.idx]->getNumOperands();
+			} else if (r.kind == 'v') {
+				ok = ok && r.idx < vertices;
+			}
+			op.refs.push_back(r);
+		}
+
+		if (ok) {
+			ok = this->checkOp(op);
+		}
+		if (op.kind <= ALIAS) {
+			vertices++;
+		}
+		loaded.push_back(op);
+	}
+	fclose(fp);
+
+	if (!ok || vertices != loadedVertexNum) {
+		return false;
+	}
+
+	ops.swap(loaded);
+	vertexNum = loadedVertexNum;
+	return true;
+}
+
+bool FunctionSummary::checkOp(const Op& op) {
+	const vector<Ref>& refs = op.refs;
+	auto isVertex = [&](unsigned i) {
+		return i < refs.size() && (refs[i].kind == 'v' || refs[i].kind == 'n');
+	};
+	auto isValue = [&](unsigned i) {
+		return i < refs.size() && refs[i].kind != 'v';
+	};
+	auto isInst = [&](unsigned i) {
+		return i < refs.size() && refs[i].kind == 'i';
+	};
+
+	switch (op.kind) {
+	case WRAP:
+		return refs.size() == 1 && isValue(0);
+	case DEREF:
+		return refs.size() == 2 && isVertex(0) && isVertex(1) && (refs[0].kind == 'v' || refs[1].kind == 'v');
+	case FIELD:
+		return refs.size() == 2 && refs[0].kind == 'v' && isVertex(1);
+	case ALIAS:
+	case OFFSET_EDGE:
+	case INDEX_EDGE:
+		return refs.size() == 2 && refs[0].kind == 'v' && refs[1].kind == 'v';
+	case CAST_COMB:
+		return refs.size() == 1 && isInst(0) && isa<CastInst>(insts[refs[0].idx]);
+	case RET:
+	case RESUME:
+		return refs.size() == 1 && isValue(0) && refs[0].kind != 'n';
+	case INLINE_ASM:
+		return refs.size() == 1 && isInst(0) && isa<CallInst>(insts[refs[0].idx]);
+	case VA_ARG:
+		return refs.size() == 1 && isInst(0);
+	case COMMON_CALL:
+		if (op.names.size() != 2 || refs.empty() || (refs[0].kind != 'n' && !isInst(0))) {
+			return false;
+		}
+		for (unsigned i = 1; i < refs.size(); i++) {
+			if (!isValue(i) || refs[i].kind == 'n') {
+				return false;
+			}
+		}
+		return true;
+	case POINTER_CALL:
+		if (op.names.size() != 1 || refs.size() < 2 || (refs[0].kind != 'n' && !isInst(0))) {
+			return false;
+		}
+		for (unsigned i = 1; i < refs.size(); i++) {
+			if (!isValue(i) || refs[i].kind == 'n') {
+				return false;
+			}
+		}
+		return true;
+	default:
+		return false;
+	}
+}
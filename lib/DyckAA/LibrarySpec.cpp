@@ -0,0 +1,272 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "DyckAA/LibrarySpec.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+const unsigned LibrarySpec::RET;
+
+/// See LibrarySpec.h for the format.
+static const char* BuiltinSpec =
+		"# allocators\n"
+		"malloc               *  alloc nomem\n"
+		"calloc               *  alloc nomem\n"
+		"realloc              *  alloc mod(1) ref(1)\n"
+		"valloc               *  alloc nomem\n"
+		"reallocf             *  alloc mod(1) ref(1)\n"
+		"strndup              *  alloc\n"
+		"strdup               *  alloc\n"
+		"_Znaj                *  alloc nomem\n"
+		"_ZnajRKSt9nothrow_t  *  alloc nomem\n"
+		"_Znam                *  alloc nomem\n"
+		"_ZnamRKSt9nothrow_t  *  alloc nomem\n"
+		"_Znwj                *  alloc nomem\n"
+		"_ZnwjRKSt9nothrow_t  *  alloc nomem\n"
+		"_Znwm                *  alloc nomem\n"
+		"_ZnwmRKSt9nothrow_t  *  alloc nomem\n"
+		"free                 1  mod(1)\n"
+		"_ZdlPv               1  mod(1)\n"
+		"_ZdaPv               1  mod(1)\n"
+		"\n"
+		"# strings and memory\n"
+		"strdup               1  content(1,r) ref(1)\n"
+		"__strdup             1  content(1,r) ref(1)\n"
+		"strdupa              1  content(1,r) ref(1)\n"
+		"strndup              2  content(1,r) ref(1)\n"
+		"strndupa             2  content(1,r) ref(1)\n"
+		"strcat               2  content(1,2) alias(r,1) mod(1) ref(1) ref(2)\n"
+		"strcpy               2  content(1,2) alias(r,1) mod(1) ref(2)\n"
+		"strncat              3  content(1,2) alias(r,1) mod(1) ref(1) ref(2)\n"
+		"strncpy              3  content(1,2) alias(r,1) mod(1) ref(2)\n"
+		"memcpy               3  content(1,2) alias(r,1) mod(1) ref(2)\n"
+		"memmove              3  content(1,2) alias(r,1) mod(1) ref(2)\n"
+		"strstr               2  content(2,r) alias(r,1) ref(1) ref(2)\n"
+		"strcasestr           2  content(2,r) alias(r,1) ref(1) ref(2)\n"
+		"strchr               2  alias(r,1) ref(1)\n"
+		"strrchr              2  alias(r,1) ref(1)\n"
+		"strchrnul            2  alias(r,1) ref(1)\n"
+		"rawmemchr            2  alias(r,1) ref(1)\n"
+		"memchr               3  alias(r,1) ref(1)\n"
+		"memrchr              3  alias(r,1) ref(1)\n"
+		"memset               3  alias(r,1) mod(1)\n"
+		"strtok               2  content(1,r)\n"
+		"strtok_r             3  content(1,r)\n"
+		"__strtok_r           3  content(1,r)\n"
+		"strlen               1  ref(1)\n"
+		"strnlen              2  ref(1)\n"
+		"strcmp               2  ref(1) ref(2)\n"
+		"strncmp              3  ref(1) ref(2)\n"
+		"strcasecmp           2  ref(1) ref(2)\n"
+		"strncasecmp          3  ref(1) ref(2)\n"
+		"memcmp               3  ref(1) ref(2)\n"
+		"\n"
+		"# threads\n"
+		"pthread_getspecific  1  keyvalue(1,r)\n"
+		"pthread_setspecific  2  keyvalue(1,2)\n"
+		"pthread_create       4  spawn(3,4)\n";
+
+LibrarySpec::LibrarySpec() {
+	std::istringstream is(BuiltinSpec);
+	std::string error;
+	bool ok = parse(is, "<builtin>", error);
+	assert(ok && "The built-in library spec is invalid.");
+	(void) ok;
+}
+
+bool LibrarySpec::load(const std::string& file, std::string& error) {
+	std::ifstream is(file.c_str());
+	if (!is) {
+		error = "cannot open " + file;
+		return false;
+	}
+	return parse(is, file, error);
+}
+
+/// "r" or a positive number
+static bool parsePosition(const std::string& s, unsigned& pos) {
+	if (s == "r") {
+		pos = LibrarySpec::RET;
+		return true;
+	}
+	if (s.empty() || s.size() > 4 || s.find_first_not_of("0123456789") != std::string::npos) {
+		return false;
+	}
+	pos = atoi(s.c_str());
+	return pos > 0;
+}
+
+static bool parseRelation(const std::string& s, LibrarySpec::Relation& r) {
+	size_t lp = s.find('('), comma = s.find(','), rp = s.find(')');
+
+	// mod(x) and ref(x) have one argument
+	if (lp != std::string::npos && comma == std::string::npos && rp == s.size() - 1) {
+		std::string kind = s.substr(0, lp);
+		if (kind == "mod") {
+			r.kind = LibrarySpec::MOD;
+		} else if (kind == "ref") {
+			r.kind = LibrarySpec::REF;
+		} else {
+			return false;
+		}
+		if (!parsePosition(s.substr(lp + 1, rp - lp - 1), r.x) || r.x == LibrarySpec::RET) {
+			return false;
+		}
+		r.y = r.x;
+		return true;
+	}
+
+	if (lp == std::string::npos || comma == std::string::npos || rp != s.size() - 1 || !(lp < comma && comma < rp)) {
+		return false;
+	}
+
+	std::string kind = s.substr(0, lp);
+	if (kind == "alias") {
+		r.kind = LibrarySpec::ALIAS;
+	} else if (kind == "content") {
+		r.kind = LibrarySpec::CONTENT_ALIAS;
+	} else if (kind == "keyvalue") {
+		r.kind = LibrarySpec::KEY_VALUE;
+	} else if (kind == "spawn") {
+		r.kind = LibrarySpec::SPAWN;
+	} else {
+		return false;
+	}
+
+	if (!parsePosition(s.substr(lp + 1, comma - lp - 1), r.x) || !parsePosition(s.substr(comma + 1, rp - comma - 1), r.y)) {
+		return false;
+	}
+	// a thread is spawned with arguments, not with the return value
+	return r.kind != LibrarySpec::SPAWN || (r.x != LibrarySpec::RET && r.y != LibrarySpec::RET);
+}
+
+bool LibrarySpec::parse(std::istream& is, const std::string& source, std::string& error) {
+	std::string line;
+	unsigned lineNo = 0;
+	while (std::getline(is, line)) {
+		lineNo++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+
+		std::istringstream tokens(line);
+		FunctionSpec spec;
+		if (!(tokens >> spec.name)) {
+			continue;
+		}
+
+		std::ostringstream where;
+		where << source << ":" << lineNo << ": ";
+
+		std::string argNum;
+		if (!(tokens >> argNum)) {
+			error = where.str() + "the number of arguments is missing";
+			return false;
+		}
+		unsigned n = 0;
+		if (argNum == "*") {
+			spec.argNum = -1;
+		} else if (parsePosition(argNum, n) || argNum == "0") {
+			spec.argNum = n;
+		} else {
+			error = where.str() + "invalid number of arguments '" + argNum + "'";
+			return false;
+		}
+
+		spec.alloc = false;
+		spec.knownAccesses = false;
+		std::string token;
+		while (tokens >> token) {
+			Relation r;
+			if (token == "alloc") {
+				spec.alloc = true;
+			} else if (token == "nomem") {
+				spec.knownAccesses = true;
+			} else if (!parseRelation(token, r)) {
+				error = where.str() + "invalid relation '" + token + "'";
+				return false;
+			} else if (spec.argNum != -1 && (r.x > (unsigned) spec.argNum || r.y > (unsigned) spec.argNum)) {
+				error = where.str() + "no such argument in '" + token + "'";
+				return false;
+			} else {
+				spec.knownAccesses |= r.kind == MOD || r.kind == REF;
+				spec.relations.push_back(r);
+			}
+		}
+		add(spec);
+	}
+	return true;
+}
+
+void LibrarySpec::add(const FunctionSpec& spec) {
+	for (auto& s : specs) {
+		if (s.name == spec.name && s.argNum == spec.argNum) {
+			s = spec;
+			return;
+		}
+	}
+	specs.push_back(spec);
+}
+
+void LibrarySpec::bind(Module& M) {
+	table.clear();
+	allocators.clear();
+	for (auto& s : specs) {
+		Function* f = M.getFunction(s.name);
+		if (f == NULL) {
+			continue;
+		}
+
+		vector<const FunctionSpec*>& fspecs = table[f];
+		if (s.alloc && std::find_if(fspecs.begin(), fspecs.end(), [](const FunctionSpec* fs) {return fs->alloc;}) == fspecs.end()) {
+			allocators.push_back(f);
+		}
+		fspecs.push_back(&s);
+	}
+}
+
+const LibrarySpec::FunctionSpec* LibrarySpec::lookup(const Function* f, unsigned argNum) const {
+	auto it = table.find(f);
+	if (it == table.end()) {
+		return NULL;
+	}
+
+	// the spec of the exact number of arguments first
+	const FunctionSpec* any = NULL;
+	for (auto s : it->second) {
+		if (s->argNum == (int) argNum) {
+			return s;
+		} else if (s->argNum == -1 && (!s->relations.empty() || s->knownAccesses)) {
+			any = s;
+		}
+	}
+	return any;
+}
+
+uint64_t LibrarySpec::fingerprint() const {
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	auto mix = [&h](const std::string& s) {
+		for (unsigned char c : s) {
+			h = (h ^ c) * 1099511628211ULL;
+		}
+		h = (h ^ 0xff) * 1099511628211ULL;
+	};
+
+	for (auto& s : specs) {
+		std::ostringstream os;
+		os << s.name << " " << s.argNum << " " << s.alloc << " " << s.knownAccesses;
+		for (auto& r : s.relations) {
+			os << " " << r.kind << "," << r.x << "," << r.y;
+		}
+		mix(os.str());
+	}
+	return h;
+}
@@ -0,0 +1,188 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "DyckAA/ModuleSummary.h"
+
+#include <stdio.h>
+
+// bump it if the format changes
+#define MODULE_SUMMARY_VERSION 1
+
+const unsigned ModuleSummary::NONE;
+
+/* ************************************************************************
+ * The format
+ *
+ *     dyck-module-summary <version>
+ *     module <name>
+ *     vertices <n>
+ *     edges <n>
+ *     <from> <kind> <num> <to>
+ *     globals <n>
+ *     <name> <vertex>
+ *     functions <n>
+ *     <name> <defined> <vararg> <vertex> <n> <param>... <n> <ret>... <n> <vaarg>...
+ *     calls <n>
+ *     <caller> <callee> <called value> <ret> <n> <arg>... <n> <callee>...
+ *
+ * where a name is written as <length>:<chars> and NONE as -1.
+ * ************************************************************************/
+
+static void writeName(FILE* fp, const std::string& name) {
+	fprintf(fp, " %lu:", (unsigned long) name.size());
+	fwrite(name.data(), 1, name.size(), fp);
+}
+
+static void writeVertex(FILE* fp, unsigned v) {
+	fprintf(fp, " %d", v == ModuleSummary::NONE ? -1 : (int) v);
+}
+
+static void writeVertices(FILE* fp, const vector<unsigned>& vs) {
+	fprintf(fp, " %lu", (unsigned long) vs.size());
+	for (auto v : vs) {
+		writeVertex(fp, v);
+	}
+}
+
+bool ModuleSummary::save(const std::string& file) {
+	FILE* fp = fopen(file.c_str(), "w");
+	if (!fp) {
+		return false;
+	}
+
+	fprintf(fp, "dyck-module-summary %d\nmodule", MODULE_SUMMARY_VERSION);
+	writeName(fp, module);
+	fprintf(fp, "\nvertices %u\n", vertexNum);
+
+	fprintf(fp, "edges %lu\n", (unsigned long) edges.size());
+	for (auto& e : edges) {
+		fprintf(fp, "%u %c %ld %u\n", e.from, e.kind, e.num, e.to);
+	}
+
+	fprintf(fp, "globals %lu\n", (unsigned long) globals.size());
+	for (auto& g : globals) {
+		writeName(fp, g.first);
+		writeVertex(fp, g.second);
+		fprintf(fp, "\n");
+	}
+
+	fprintf(fp, "functions %lu\n", (unsigned long) functions.size());
+	for (auto& f : functions) {
+		writeName(fp, f.name);
+		fprintf(fp, " %d %d", f.defined ? 1 : 0, f.varArg ? 1 : 0);
+		writeVertex(fp, f.vertex);
+		writeVertices(fp, f.params);
+		writeVertices(fp, f.rets);
+		writeVertices(fp, f.vaargs);
+		fprintf(fp, "\n");
+	}
+
+	fprintf(fp, "calls %lu\n", (unsigned long) calls.size());
+	for (auto& c : calls) {
+		writeName(fp, c.caller);
+		writeName(fp, c.callee);
+		writeVertex(fp, c.calledValue);
+		writeVertex(fp, c.ret);
+		writeVertices(fp, c.args);
+		fprintf(fp, " %lu", (unsigned long) c.callees.size());
+		for (auto& callee : c.callees) {
+			writeName(fp, callee);
+		}
+		fprintf(fp, "\n");
+	}
+
+	bool ok = !ferror(fp);
+	return fclose(fp) == 0 && ok;
+}
+
+static bool readName(FILE* fp, std::string& name) {
+	unsigned long len;
+	if (fscanf(fp, " %lu:", &len) != 1 || len > 65536) {
+		return false;
+	}
+	name.assign(len, '\0');
+	return len == 0 || fread(&name[0], 1, len, fp) == len;
+}
+
+static bool readVertex(FILE* fp, unsigned vertexNum, unsigned& v) {
+	int i;
+	if (fscanf(fp, "%d", &i) != 1 || i < -1 || (i >= 0 && (unsigned) i >= vertexNum)) {
+		return false;
+	}
+	v = i == -1 ? ModuleSummary::NONE : (unsigned) i;
+	return true;
+}
+
+static bool readVertices(FILE* fp, unsigned vertexNum, vector<unsigned>& vs) {
+	unsigned long n;
+	if (fscanf(fp, "%lu", &n) != 1 || n > 65536) {
+		return false;
+	}
+	vs.resize(n);
+	for (unsigned long i = 0; i < n; i++) {
+		if (!readVertex(fp, vertexNum, vs[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ModuleSummary::load(const std::string& file) {
+	FILE* fp = fopen(file.c_str(), "r");
+	if (!fp) {
+		return false;
+	}
+
+	int version;
+	unsigned long n;
+	bool ok = fscanf(fp, "dyck-module-summary %d module", &version) == 1 && version == MODULE_SUMMARY_VERSION;
+	ok = ok && readName(fp, module) && fscanf(fp, " vertices %u", &vertexNum) == 1;
+
+	ok = ok && fscanf(fp, " edges %lu", &n) == 1;
+	for (unsigned long i = 0; ok && i < n; i++) {
+		Edge e;
+		ok = fscanf(fp, "%u %c %ld %u", &e.from, &e.kind, &e.num, &e.to) == 4;
+		ok = ok && e.from < vertexNum && e.to < vertexNum && (e.kind == 'd' || e.kind == 'o' || e.kind == 'i');
+		edges.push_back(e);
+	}
+
+	ok = ok && fscanf(fp, " globals %lu", &n) == 1;
+	for (unsigned long i = 0; ok && i < n; i++) {
+		pair<std::string, unsigned> g;
+		ok = readName(fp, g.first) && readVertex(fp, vertexNum, g.second);
+		globals.push_back(g);
+	}
+
+	ok = ok && fscanf(fp, " functions %lu", &n) == 1;
+	for (unsigned long i = 0; ok && i < n; i++) {
+		FunctionInfo f;
+		int defined, varArg;
+		ok = readName(fp, f.name) && fscanf(fp, "%d %d", &defined, &varArg) == 2;
+		ok = ok && readVertex(fp, vertexNum, f.vertex);
+		ok = ok && readVertices(fp, vertexNum, f.params) && readVertices(fp, vertexNum, f.rets);
+		ok = ok && readVertices(fp, vertexNum, f.vaargs);
+		f.defined = defined;
+		f.varArg = varArg;
+		functions.push_back(f);
+	}
+
+	ok = ok && fscanf(fp, " calls %lu", &n) == 1;
+	for (unsigned long i = 0; ok && i < n; i++) {
+		CallInfo c;
+		unsigned long calleeNum;
+		ok = readName(fp, c.caller) && readName(fp, c.callee);
+		ok = ok && readVertex(fp, vertexNum, c.calledValue) && readVertex(fp, vertexNum, c.ret);
+		ok = ok && readVertices(fp, vertexNum, c.args) && fscanf(fp, "%lu", &calleeNum) == 1;
+		for (unsigned long j = 0; ok && j < calleeNum; j++) {
+			std::string callee;
+			ok = readName(fp, callee);
+			c.callees.push_back(callee);
+		}
+		calls.push_back(c);
+	}
+
+	fclose(fp);
+	return ok;
+}
@@ -0,0 +1,92 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "DyckAA/Progress.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+static cl::opt<unsigned> ProgressInterval("progress-interval", cl::init(200), cl::Hidden,
+		cl::desc("The min interval (ms) between two progress updates."));
+
+static cl::opt<int> ProgressFD("progress-fd", cl::init(-1), cl::Hidden,
+		cl::desc("Write machine-readable progress events into the file descriptor."));
+
+Progress::Progress(const char* p, unsigned long t) :
+		phase(p), done(0), total(t), finished(false) {
+	startTime = Clock::now();
+	lastTime = startTime;
+	console = outs().is_displayed();
+	emit("start", startTime);
+}
+
+Progress::~Progress() {
+	finish();
+}
+
+void Progress::update(unsigned long d) {
+	done = d > total ? total : d;
+	if (!console && ProgressFD < 0) {
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (now - lastTime < std::chrono::milliseconds(ProgressInterval)) {
+		return;
+	}
+	lastTime = now;
+
+	if (console) {
+		long e = eta(now);
+		outs() << phase << "... " << (total ? done * 100 / total : 100) << "%, " << done << "/" << total;
+		if (e >= 0) {
+			outs() << ", " << e << "s left";
+		}
+		outs() << "          \r";
+		outs().flush();
+	}
+	emit("update", now);
+}
+
+void Progress::finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+
+	if (console) {
+		outs() << "                                                            \r";
+		outs().flush();
+	}
+	emit("finish", Clock::now());
+}
+
+long Progress::eta(Clock::time_point now) {
+	if (done == 0) {
+		return -1;
+	}
+	double elapsed = std::chrono::duration<double>(now - startTime).count();
+	return (long) (elapsed / done * (total - done));
+}
+
+void Progress::emit(const char* event, Clock::time_point now) {
+	if (ProgressFD < 0) {
+		return;
+	}
+
+	char buf[512];
+	int len = snprintf(buf, sizeof (buf), "progress event=%s phase=\"%s\" done=%lu total=%lu eta=%ld\n", event,
+			phase.c_str(), done, total, eta(now));
+	if (len > 0) {
+		// progress is best-effort, errors are ignored
+		ssize_t r = write(ProgressFD, buf, (size_t) len < sizeof (buf) ? len : sizeof (buf) - 1);
+		(void) r;
+	}
+}
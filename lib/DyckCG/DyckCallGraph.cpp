@@ -5,10 +5,122 @@
 
 #include "DyckCG/DyckCallGraph.h"
 
+#include <algorithm>
+
 static cl::opt<bool>
 WithEdgeLabels("with-labels", cl::init(false), cl::Hidden,
         cl::desc("Determine whether there are edge lables in the cg."));
 
+void DyckCallGraph::build(bool pointerCalls) {
+    unsigned n = nodes.size();
+
+    // callees, in the order of their indices without duplicates
+    calleeOffsets.assign(n + 1, 0);
+    callees.clear();
+    vector<unsigned> targets;
+    for (unsigned i = 0; i < n; i++) {
+        targets.clear();
+        for (auto c : nodes[i]->getCommonCalls()) {
+            auto it = nodeIndices.find((Function*) c->calledValue);
+            if (it != nodeIndices.end()) {
+                targets.push_back(it->second);
+            }
+        }
+        if (pointerCalls) {
+            for (auto c : nodes[i]->getPointerCalls()) {
+                for (auto callee : c->mayAliasedCallees) {
+                    auto it = nodeIndices.find(callee);
+                    if (it != nodeIndices.end()) {
+                        targets.push_back(it->second);
+                    }
+                }
+            }
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        callees.insert(callees.end(), targets.begin(), targets.end());
+        calleeOffsets[i + 1] = callees.size();
+    }
+
+    // callers, grouped by the callees, and sorted since the callers are
+    // visited in order
+    callerOffsets.assign(n + 1, 0);
+    for (auto j : callees) {
+        callerOffsets[j + 1]++;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        callerOffsets[i + 1] += callerOffsets[i];
+    }
+    callers.resize(callees.size());
+    vector<unsigned> next(callerOffsets.begin(), callerOffsets.end() - 1);
+    for (unsigned i = 0; i < n; i++) {
+        for (unsigned e = calleeOffsets[i]; e < calleeOffsets[i + 1]; e++) {
+            callers[next[callees[e]]++] = i;
+        }
+    }
+
+    // Tarjan's algorithm without recursion, which finds an SCC after all
+    // the SCCs it reaches
+    sccOffsets.assign(1, 0);
+    sccNodes.clear();
+    nodeSCCs.assign(n, 0);
+
+    const unsigned UNVISITED = ~0U;
+    vector<unsigned> indices(n, UNVISITED);
+    vector<unsigned> lowlinks(n, 0);
+    vector<bool> onStack(n, false);
+    vector<unsigned> sccStack;
+    vector<pair<unsigned, unsigned> > dfsStack; // node, next edge
+    unsigned index = 0;
+
+    for (unsigned root = 0; root < n; root++) {
+        if (indices[root] != UNVISITED) {
+            continue;
+        }
+
+        dfsStack.push_back(make_pair(root, calleeOffsets[root]));
+        while (!dfsStack.empty()) {
+            unsigned v = dfsStack.back().first;
+            unsigned& edge = dfsStack.back().second;
+            if (indices[v] == UNVISITED) {
+                indices[v] = lowlinks[v] = index++;
+                sccStack.push_back(v);
+                onStack[v] = true;
+            }
+
+            if (edge < calleeOffsets[v + 1]) {
+                unsigned w = callees[edge++];
+                if (indices[w] == UNVISITED) {
+                    dfsStack.push_back(make_pair(w, calleeOffsets[w]));
+                } else if (onStack[w]) {
+                    lowlinks[v] = std::min(lowlinks[v], indices[w]);
+                }
+                continue;
+            }
+
+            dfsStack.pop_back();
+            if (!dfsStack.empty()) {
+                unsigned u = dfsStack.back().first;
+                lowlinks[u] = std::min(lowlinks[u], lowlinks[v]);
+            }
+
+            if (lowlinks[v] == indices[v]) {
+                unsigned w;
+                do {
+                    w = sccStack.back();
+                    sccStack.pop_back();
+                    onStack[w] = false;
+                    nodeSCCs[w] = sccOffsets.size() - 1;
+                    sccNodes.push_back(w);
+                } while (w != v);
+                sccOffsets.push_back(sccNodes.size());
+            }
+        }
+    }
+
+    topologicalOrder.assign(sccNodes.rbegin(), sccNodes.rend());
+}
+
 void DyckCallGraph::dotCallGraph(const string& mIdentifier) {
     string dotfilename("");
     dotfilename.append(mIdentifier);
@@ -17,23 +129,23 @@ void DyckCallGraph::dotCallGraph(const string& mIdentifier) {
     FILE * fout = fopen(dotfilename.data(), "w+");
     fprintf(fout, "digraph maycg {\n");
     
-    auto fwIt = FunctionMap.begin();
-    while (fwIt != FunctionMap.end()) {
-        DyckCallGraphNode* fw = fwIt->second;
+    auto fwIt = nodes.begin();
+    while (fwIt != nodes.end()) {
+        DyckCallGraphNode* fw = *fwIt;
         fprintf(fout, "\tf%d[label=\"%s\"]\n", fw->getIndex(), fw->getLLVMFunction()->getName().data());
         fwIt++;
     }
 
-    fwIt = FunctionMap.begin();
-    while (fwIt != FunctionMap.end()) {
-        DyckCallGraphNode* fw = fwIt->second;
-        set<CommonCall*>* commonCalls = &(fw->getCommonCalls());
-        set<CommonCall*>::iterator comIt = commonCalls->begin();
+    fwIt = nodes.begin();
+    while (fwIt != nodes.end()) {
+        DyckCallGraphNode* fw = *fwIt;
+        vector<CommonCall*>* commonCalls = &(fw->getCommonCalls());
+        vector<CommonCall*>::iterator comIt = commonCalls->begin();
         while (comIt != commonCalls->end()) {
             CommonCall* cc = *comIt;
-            Function * callee = (Function*) cc->calledValue;
+            DyckCallGraphNode * callee = this->lookupFunction((Function*) cc->calledValue);
 
-            if (FunctionMap.count(callee)) {
+            if (callee != NULL) {
                 if (WithEdgeLabels) {
                     Value * ci = cc->instruction;
                     std::string s;
@@ -53,9 +165,9 @@ void DyckCallGraph::dotCallGraph(const string& mIdentifier) {
                             edgelabel[i] = ' ';
                         }
                     }
-                    fprintf(fout, "\tf%d->f%d[label=\"%s\"]\n", fw->getIndex(), FunctionMap[callee]->getIndex(), edgelabel.data());
+                    fprintf(fout, "\tf%d->f%d[label=\"%s\"]\n", fw->getIndex(), callee->getIndex(), edgelabel.data());
                 } else {
-                    fprintf(fout, "\tf%d->f%d\n", fw->getIndex(), FunctionMap[callee]->getIndex());
+                    fprintf(fout, "\tf%d->f%d\n", fw->getIndex(), callee->getIndex());
                 }
             } else {
                 errs() << "ERROR in printCG when print common function calls.\n";
@@ -64,11 +176,11 @@ void DyckCallGraph::dotCallGraph(const string& mIdentifier) {
             comIt++;
         }
 
-        set<PointerCall*>* fpCallsMap = &(fw->getPointerCalls());
-        set<PointerCall*>::iterator fpIt = fpCallsMap->begin();
+        vector<PointerCall*>* fpCallsMap = &(fw->getPointerCalls());
+        vector<PointerCall*>::iterator fpIt = fpCallsMap->begin();
         while (fpIt != fpCallsMap->end()) {
             PointerCall* pcall = *fpIt;
-            set<Function*>* mayCalled = &((*fpIt)->mayAliasedCallees);
+            SetVector<Function*>* mayCalled = &((*fpIt)->mayAliasedCallees);
 
             char * edgeLabelData = NULL;
             if (WithEdgeLabels) {
@@ -91,14 +203,14 @@ void DyckCallGraph::dotCallGraph(const string& mIdentifier) {
                 }
                 edgeLabelData = const_cast<char*> (edgelabel.data());
             }
-            set<Function*>::iterator mcIt = mayCalled->begin();
+            SetVector<Function*>::iterator mcIt = mayCalled->begin();
             while (mcIt != mayCalled->end()) {
-                Function * mcf = *mcIt;
-                if (FunctionMap.count(mcf)) {
+                DyckCallGraphNode * mcf = this->lookupFunction(*mcIt);
+                if (mcf != NULL) {
                     if (WithEdgeLabels) {
-                        fprintf(fout, "\tf%d->f%d[label=\"%s\"]\n", fw->getIndex(), FunctionMap[mcf]->getIndex(), edgeLabelData);
+                        fprintf(fout, "\tf%d->f%d[label=\"%s\"]\n", fw->getIndex(), mcf->getIndex(), edgeLabelData);
                     } else {
-                        fprintf(fout, "\tf%d->f%d\n", fw->getIndex(), FunctionMap[mcf]->getIndex());
+                        fprintf(fout, "\tf%d->f%d\n", fw->getIndex(), mcf->getIndex());
                     }
                 } else {
                     errs() << "ERROR in printCG when print fp calls.\n";
@@ -128,10 +240,10 @@ void DyckCallGraph::printFunctionPointersInformation(const string& mIdentifier)
 
     auto fwIt = this->begin();
     while (fwIt != this->end()) {
-        DyckCallGraphNode* fw = fwIt->second;
+        DyckCallGraphNode* fw = *fwIt;
 
-        set<PointerCall*>* fpCallsMap = &(fw->getPointerCalls());
-        set<PointerCall*>::iterator fpIt = fpCallsMap->begin();
+        vector<PointerCall*>* fpCallsMap = &(fw->getPointerCalls());
+        vector<PointerCall*>::iterator fpIt = fpCallsMap->begin();
         while (fpIt != fpCallsMap->end()) {
             /*Value * callInst = fpIt->first;
             std::string s;
@@ -149,11 +261,11 @@ void DyckCallGraph::printFunctionPointersInformation(const string& mIdentifier)
             }
             fprintf(fout, "CallInst: %s\n", edgelabel.data()); //call inst
              */
-            set<Function*>* mayCalled = &((*(fpIt))->mayAliasedCallees);
+            SetVector<Function*>* mayCalled = &((*(fpIt))->mayAliasedCallees);
             fprintf(fout, "%zd\n", mayCalled->size()); //number of functions
 
             // what functions?
-            set<Function*>::iterator mcIt = mayCalled->begin();
+            SetVector<Function*>::iterator mcIt = mayCalled->begin();
             while (mcIt != mayCalled->end()) {
                 // Function * mcf = *mcIt;
                 //fprintf(fout, "%s\n", mcf->getName().data());
@@ -24,11 +24,9 @@ CommonCall::CommonCall(Instruction* inst, Function * func, vector<Value*>* args)
 PointerCall::PointerCall(Instruction* inst, Value* calledValue, vector<Value*>* args) : Call(inst, calledValue, args), mustAliasedPointerCall(false) {
 }
 
-int DyckCallGraphNode::global_idx = 0;
-
-DyckCallGraphNode::DyckCallGraphNode(Function *f) {
+DyckCallGraphNode::DyckCallGraphNode(Function *f, int idx) {
     llvm_function = f;
-    idx = global_idx++;
+    this->idx = idx;
 
     iplist<Argument>& alt = f->getArgumentList();
     iplist<Argument>::iterator it = alt.begin();
@@ -40,44 +38,33 @@ DyckCallGraphNode::DyckCallGraphNode(Function *f) {
 }
 
 DyckCallGraphNode::~DyckCallGraphNode() {
-    set<PointerCall *>::iterator it = pointerCalls.begin();
-    while (it != pointerCalls.end()) {
-        delete (*it);
-        it++;
-    }
-
-    set<CommonCall *>::iterator cit = commonCalls.begin();
-    while (cit != commonCalls.end()) {
-        delete *cit;
-        cit++;
-    }
-
+    // calls are released by DyckCallGraph
 }
 
 int DyckCallGraphNode::getIndex() {
     return idx;
 }
 
-set<PointerCall *>& DyckCallGraphNode::getPointerCalls() {
+vector<PointerCall *>& DyckCallGraphNode::getPointerCalls() {
     return pointerCalls;
 }
 
 void DyckCallGraphNode::addPointerCall(PointerCall* call) {
     instructionCallMap.insert(pair<Instruction*, Call*>(call->instruction, call));
-    pointerCalls.insert(call);
+    pointerCalls.push_back(call);
 }
 
 Function* DyckCallGraphNode::getLLVMFunction() {
     return llvm_function;
 }
 
-set<CommonCall *>& DyckCallGraphNode::getCommonCalls() {
+vector<CommonCall *>& DyckCallGraphNode::getCommonCalls() {
     return commonCalls;
 }
 
 void DyckCallGraphNode::addCommonCall(CommonCall * call) {
     instructionCallMap.insert(pair<Instruction*, Call*>(call->instruction, call));
-    commonCalls.insert(call);
+    commonCalls.push_back(call);
 }
 
 void DyckCallGraphNode::addResume(Value * res) {
@@ -73,6 +73,7 @@ bool DyckGraph::containsInWorkList(multimap<DyckVertex*, void*>& list, DyckVerte
 }
 
 DyckVertex* DyckGraph::combine(DyckVertex* x, DyckVertex* y) {
+	assert(!frozen);
 	assert(vertices.count(x));
 	assert(vertices.count(y));
 	
@@ -148,12 +149,12 @@ DyckVertex* DyckGraph::combine(DyckVertex* x, DyckVertex* y) {
 	y->mvEquivalentSetTo(x);
 	vertices.erase(y);
 //     printf("DELETE %d\n", y->getIndex());
-	delete y;
+	destroyVertex(y);
 	return x;
 }
 
 bool DyckGraph::qirunAlgorithm() {
-	bool ret = true;
+	assert(!frozen);
 
 	multimap<DyckVertex*, void*> worklist;
 
@@ -171,6 +172,35 @@ bool DyckGraph::qirunAlgorithm() {
 		vit++;
 	}
 
+	return this->propagate(worklist);
+}
+
+bool DyckGraph::qirunAlgorithm(const set<DyckVertex*>& seeds) {
+	assert(!frozen);
+
+	multimap<DyckVertex*, void*> worklist;
+
+	set<DyckVertex*>::const_iterator vit = seeds.begin();
+	while (vit != seeds.end()) {
+		if (vertices.count(*vit)) {
+			set<void*>& outlabels = (*vit)->getOutLabels();
+			set<void*>::iterator lit = outlabels.begin();
+			while (lit != outlabels.end()) {
+				if ((*vit)->outNumVertices(*lit) > 1) {
+					worklist.insert(pair<DyckVertex*, void*>(*vit, *lit));
+				}
+				lit++;
+			}
+		}
+
+		vit++;
+	}
+
+	return this->propagate(worklist);
+}
+
+bool DyckGraph::propagate(multimap<DyckVertex*, void*>& worklist) {
+	bool ret = true;
 	if (!worklist.empty()) {
 		ret = false;
 	}
@@ -272,15 +302,33 @@ bool DyckGraph::qirunAlgorithm() {
 			yilit++;
 		}
 
-		delete y;
+		destroyVertex(y);
 	}
 
 	return ret;
 }
 
+void DyckGraph::destroyVertex(DyckVertex* v) {
+	for (auto& it : v->getOutVertices()) {
+		edgeSetAllocator.destroy(it.second);
+	}
+	for (auto& it : v->getInVertices()) {
+		edgeSetAllocator.destroy(it.second);
+	}
+	vertexAllocator.destroy(v);
+}
+
 pair<DyckVertex*, bool> DyckGraph::retrieveDyckVertex(void* value, const char* name) {
+	if (frozen) {
+		DyckVertex* ver = findDyckVertex(value);
+		if (ver == NULL) {
+			return std::make_pair(sentinel, false);
+		}
+		return std::make_pair(ver, true);
+	}
+
 	if (value == NULL) {
-		DyckVertex* ver = new DyckVertex(NULL);
+		DyckVertex* ver = vertexAllocator.create(&edgeSetAllocator, (void*) NULL);
 		vertices.insert(ver);
 		return std::make_pair(ver, false);
 	}
@@ -289,13 +337,31 @@ pair<DyckVertex*, bool> DyckGraph::retrieveDyckVertex(void* value, const char* n
 	if (it != val_ver_map.end()) {
 		return std::make_pair(it->second, true);
 	} else {
-		DyckVertex* ver = new DyckVertex(value, name);
+		DyckVertex* ver = vertexAllocator.create(&edgeSetAllocator, value, name);
 		vertices.insert(ver);
 		val_ver_map.insert(pair<void *, DyckVertex*>(value, ver));
 		return std::make_pair(ver, false);
 	}
 }
 
+DyckVertex* DyckGraph::bindDyckVertex(void* value, DyckVertex* ver) {
+	assert(!frozen);
+	assert(value != NULL && !val_ver_map.count(value));
+	assert(vertices.count(ver));
+
+	ver->equivclass.insert(value);
+	val_ver_map.insert(pair<void *, DyckVertex*>(value, ver));
+	return ver;
+}
+
+void DyckGraph::unbindDyckVertex(void* value) {
+	auto it = val_ver_map.find(value);
+	if (it != val_ver_map.end()) {
+		it->second->equivclass.erase(value);
+		val_ver_map.erase(it);
+	}
+}
+
 DyckVertex* DyckGraph::findDyckVertex(void* value) {
     auto it = val_ver_map.find(value);
     if (it != val_ver_map.end()) {
@@ -304,6 +370,17 @@ DyckVertex* DyckGraph::findDyckVertex(void* value) {
     return NULL;
 }
 
+void DyckGraph::freeze() {
+	if (frozen) {
+		return;
+	}
+
+	sentinel = vertexAllocator.create(&edgeSetAllocator, (void*) NULL);
+	// shrink the buckets, since no more values are added
+	val_ver_map.rehash(0);
+	frozen = true;
+}
+
 unsigned int DyckGraph::numVertices() {
 	return vertices.size();
 }
@@ -8,7 +8,8 @@
 
 int DyckVertex::global_indx = 0;
 
-DyckVertex::DyckVertex(void * v, const char * itsname) {
+DyckVertex::DyckVertex(EdgeSetAllocator* edgesets, void * v, const char * itsname) {
+	edge_sets = edgesets;
 	name = itsname;
 	index = global_indx++;
 
@@ -25,15 +26,17 @@ const char * DyckVertex::getName() {
 }
 
 unsigned int DyckVertex::outNumVertices(void* label) {
-	if (out_vers.count(label)) {
-		return out_vers[label]->size();
+	auto it = out_vers.find(label);
+	if (it != out_vers.end()) {
+		return it->second->size();
 	}
 	return 0;
 }
 
 unsigned int DyckVertex::inNumVertices(void* label) {
-	if (in_vers.count(label)) {
-		return in_vers[label]->size();
+	auto it = in_vers.find(label);
+	if (it != in_vers.end()) {
+		return it->second->size();
 	}
 	return 0;
 }
@@ -95,7 +98,7 @@ int DyckVertex::getIndex() {
 void DyckVertex::addTarget(DyckVertex* ver, void* label) {
 	out_lables.insert(label);
 	if (!out_vers.count(label)) {
-		set<DyckVertex*>* tars = new set<DyckVertex*>;
+		set<DyckVertex*>* tars = edge_sets->create();
 		tars->insert(ver);
 		out_vers.insert(pair<void*, set<DyckVertex*>*>(label, tars));
 	} else {
@@ -114,23 +117,28 @@ void DyckVertex::removeTarget(DyckVertex* ver, void* label) {
 }
 
 bool DyckVertex::containsTarget(DyckVertex* tar, void* label) {
-	if (out_vers.count(label)) {
-		return out_vers[label]->find(tar) != out_vers[label]->end();
+	auto it = out_vers.find(label);
+	if (it != out_vers.end()) {
+		return it->second->find(tar) != it->second->end();
 	}
 
 	return false;
 }
 
+// the followings only use find, which is safe for concurrent queries
+
 set<DyckVertex*>* DyckVertex::getInVertices(void * label) {
-	if (in_vers.count(label)) {
-		return this->in_vers[label];
+	auto it = in_vers.find(label);
+	if (it != in_vers.end()) {
+		return it->second;
 	}
 	return NULL;
 }
 
 set<DyckVertex*>* DyckVertex::getOutVertices(void * label) {
-	if (out_vers.count(label)) {
-		return this->out_vers[label];
+	auto it = out_vers.find(label);
+	if (it != out_vers.end()) {
+		return it->second;
 	}
 	return NULL;
 }
@@ -140,7 +148,7 @@ set<DyckVertex*>* DyckVertex::getOutVertices(void * label) {
 void DyckVertex::addSource(DyckVertex* ver, void* label) {
 	in_lables.insert(label);
 	if (!in_vers.count(label)) {
-		set<DyckVertex*>* srcs = new set<DyckVertex*>;
+		set<DyckVertex*>* srcs = edge_sets->create();
 		srcs->insert(ver);
 		in_vers.insert(pair<void*, set<DyckVertex*>*>(label, srcs));
 	} else {
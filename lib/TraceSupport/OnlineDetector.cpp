@@ -0,0 +1,285 @@
+/*
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include "TraceSupport/OnlineDetector.h"
+
+#include <stdlib.h>
+
+#define NO_TID -1
+#define SHARED_TID -2
+
+OnlineDetector::OnlineDetector() : race_num(0), fout(NULL) {
+    pthread_mutex_init(&mutex, NULL);
+}
+
+OnlineDetector::~OnlineDetector() {
+    pthread_mutex_destroy(&mutex);
+}
+
+void OnlineDetector::init(const char* filename) {
+    fout = fopen(filename, "w+");
+    if (!fout) {
+        printf("[CANARY] Cannot open File %s!\n", filename);
+        exit(-1);
+    }
+}
+
+void OnlineDetector::finish() {
+    pthread_mutex_lock(&mutex);
+    if (fout) {
+        printf("[CANARY] DR: %lu (online)\n", race_num);
+        fprintf(fout, "[CANARY] DR: %lu (online)\n", race_num);
+        fclose(fout);
+        fout = NULL;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* ************************************************************************
+ * Accesses
+ * ************************************************************************/
+
+void OnlineDetector::onRead(pthread_t t, long mem, const char * file, long line) {
+    pthread_mutex_lock(&mutex);
+
+    int tid = getThreadId(t);
+    VectorClock& C = thread_vcs[tid];
+    Epoch E = epoch(tid);
+    Site site = {file, line};
+
+    unordered_map<long, Shadow>::iterator it = shadows.find(mem);
+    if (it == shadows.end()) {
+        Shadow s;
+        s.write.tid = NO_TID;
+        s.write.clock = 0;
+        s.read = E;
+        s.read_site = site;
+        shadows.insert(pair<long, Shadow>(mem, s));
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    Shadow& s = it->second;
+
+    // same epoch
+    if (s.read.tid == tid && s.read.clock == E.clock) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    if (s.read.tid == SHARED_TID && s.read_vc.size() > (unsigned) tid && s.read_vc[tid] == E.clock) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    // write-read race
+    if (s.write.tid != NO_TID && s.write.tid != tid && !happensBefore(s.write, C)) {
+        report("write-read", mem, s.write_site, site);
+    }
+
+    // update the read state
+    if (s.read.tid == SHARED_TID) {
+        if (s.read_vc.size() <= (unsigned) tid) {
+            s.read_vc.resize(tid + 1, 0);
+            s.read_vc_sites.resize(tid + 1);
+        }
+        s.read_vc[tid] = E.clock;
+        s.read_vc_sites[tid] = site;
+    } else if (s.read.tid == NO_TID || s.read.tid == tid || happensBefore(s.read, C)) {
+        s.read = E;
+        s.read_site = site;
+    } else {
+        // concurrent reads, switch to the vector clock mode
+        unsigned size = (s.read.tid > tid ? s.read.tid : tid) + 1;
+        s.read_vc.assign(size, 0);
+        s.read_vc_sites.assign(size, site);
+        s.read_vc[s.read.tid] = s.read.clock;
+        s.read_vc_sites[s.read.tid] = s.read_site;
+        s.read_vc[tid] = E.clock;
+        s.read.tid = SHARED_TID;
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onWrite(pthread_t t, long mem, const char * file, long line) {
+    pthread_mutex_lock(&mutex);
+
+    int tid = getThreadId(t);
+    VectorClock& C = thread_vcs[tid];
+    Epoch E = epoch(tid);
+    Site site = {file, line};
+
+    unordered_map<long, Shadow>::iterator it = shadows.find(mem);
+    if (it == shadows.end()) {
+        Shadow s;
+        s.write = E;
+        s.write_site = site;
+        s.read.tid = NO_TID;
+        s.read.clock = 0;
+        shadows.insert(pair<long, Shadow>(mem, s));
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    Shadow& s = it->second;
+
+    // same epoch
+    if (s.write.tid == tid && s.write.clock == E.clock) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    // write-write race
+    if (s.write.tid != NO_TID && s.write.tid != tid && !happensBefore(s.write, C)) {
+        report("write-write", mem, s.write_site, site);
+    }
+
+    // read-write race
+    if (s.read.tid == SHARED_TID) {
+        for (unsigned u = 0; u < s.read_vc.size(); u++) {
+            Epoch r = {(int) u, s.read_vc[u]};
+            if ((int) u != tid && r.clock != 0 && !happensBefore(r, C)) {
+                report("read-write", mem, s.read_vc_sites[u], site);
+            }
+        }
+        s.read.tid = NO_TID;
+        s.read.clock = 0;
+        s.read_vc.clear();
+        s.read_vc_sites.clear();
+    } else if (s.read.tid != NO_TID && s.read.tid != tid && !happensBefore(s.read, C)) {
+        report("read-write", mem, s.read_site, site);
+    }
+
+    s.write = E;
+    s.write_site = site;
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* ************************************************************************
+ * Synchronizations
+ * ************************************************************************/
+
+void OnlineDetector::onAcquire(pthread_t t, long lock) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+    join(thread_vcs[tid], lock_vcs[lock]);
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onRelease(pthread_t t, long lock) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+    lock_vcs[lock] = thread_vcs[tid];
+    thread_vcs[tid][tid]++;
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onFork(pthread_t t, pthread_t child) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+
+    unordered_map<pthread_t, int>::iterator it = thread_ids.find(child);
+    if (it != thread_ids.end()) {
+        // the child has run before the fork is reported
+        join(thread_vcs[it->second], thread_vcs[tid]);
+    } else {
+        forked_vcs[child] = thread_vcs[tid];
+    }
+    thread_vcs[tid][tid]++;
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onJoin(pthread_t t, pthread_t child) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+
+    unordered_map<pthread_t, int>::iterator it = thread_ids.find(child);
+    if (it != thread_ids.end()) {
+        join(thread_vcs[tid], thread_vcs[it->second]);
+        // pthread_t may be reused by a thread created later
+        thread_ids.erase(it);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onWait(pthread_t t, long cond, long lock) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+    join(thread_vcs[tid], cond_vcs[cond]);
+    join(thread_vcs[tid], lock_vcs[lock]);
+    pthread_mutex_unlock(&mutex);
+}
+
+void OnlineDetector::onNotify(pthread_t t, long cond) {
+    pthread_mutex_lock(&mutex);
+    int tid = getThreadId(t);
+    join(cond_vcs[cond], thread_vcs[tid]);
+    thread_vcs[tid][tid]++;
+    pthread_mutex_unlock(&mutex);
+}
+
+/* ************************************************************************
+ * Private functions
+ * ************************************************************************/
+
+int OnlineDetector::getThreadId(pthread_t t) {
+    unordered_map<pthread_t, int>::iterator it = thread_ids.find(t);
+    if (it != thread_ids.end()) {
+        return it->second;
+    }
+
+    int tid = thread_vcs.size();
+    thread_ids.insert(pair<pthread_t, int>(t, tid));
+
+    VectorClock vc;
+    unordered_map<pthread_t, VectorClock>::iterator fit = forked_vcs.find(t);
+    if (fit != forked_vcs.end()) {
+        vc = fit->second;
+        forked_vcs.erase(fit);
+    }
+    vc.resize(tid + 1, 0);
+    vc[tid] = 1;
+
+    thread_vcs.push_back(vc);
+    return tid;
+}
+
+OnlineDetector::Epoch OnlineDetector::epoch(int tid) {
+    Epoch e = {tid, thread_vcs[tid][tid]};
+    return e;
+}
+
+bool OnlineDetector::happensBefore(const Epoch& e, const VectorClock& vc) {
+    unsigned c = vc.size() > (unsigned) e.tid ? vc[e.tid] : 0;
+    return e.clock <= c;
+}
+
+void OnlineDetector::join(VectorClock& to, const VectorClock& from) {
+    if (to.size() < from.size()) {
+        to.resize(from.size(), 0);
+    }
+    for (unsigned i = 0; i < from.size(); i++) {
+        if (to[i] < from[i]) to[i] = from[i];
+    }
+}
+
+void OnlineDetector::report(const char* kind, long mem, const Site& prev, const Site& cur) {
+    char buf[256];
+    snprintf(buf, sizeof (buf), "%s:%ld", prev.file ? prev.file : "", prev.line);
+    string a(buf);
+    snprintf(buf, sizeof (buf), "%s:%ld", cur.file ? cur.file : "", cur.line);
+    string b(buf);
+
+    // report each pair of source locations only once
+    pair<string, string> key = a < b ? make_pair(a, b) : make_pair(b, a);
+    if (!reported.insert(key).second) {
+        return;
+    }
+
+    race_num++;
+    if (fout) {
+        fprintf(fout, "[Data Races] %s on %ld at %s and %s.\n", kind, mem, a.c_str(), b.c_str());
+        fflush(fout);
+    }
+}
@@ -12,6 +12,7 @@
 
 #include <list>
 #include "TraceSupport/Event.h"
+#include "TraceSupport/OnlineDetector.h"
 
 using namespace std;
 
@@ -28,8 +29,6 @@ void createEvent(int eid,
         pthread_t tid, //unsigned long int %lu
         long mem,
         int type,
-        int * locks,
-        int lock_num,
         pthread_t synctid,
         pthread_cond_t * cond,
         const char * srcfile,
@@ -40,8 +39,7 @@ void createEvent(int eid,
     events[events_pointer].mem = mem;
     events[events_pointer].type = type;
     strcpy(events[events_pointer].srcfile, srcfile);
-    events[events_pointer].locks = locks;
-    events[events_pointer].lock_num = lock_num;
+    events[events_pointer].lockset = 0;
     events[events_pointer].synctid = synctid;
     events[events_pointer].cond = cond;
     events[events_pointer++].line = line;
@@ -52,11 +50,162 @@ void createEvent(int eid,
     }
 }
 
+/// Append the accesses of a batch, see OnAccesses, with one bound check.
+void appendAccesses(pthread_t tid, long** mems, int* sites, long* lines, int n, const char* srcfile) {
+    if (events_pointer + n >= MAX_EVENT_NUM) {
+        printf(">= %d\n", MAX_EVENT_NUM);
+        exit(-1);
+    }
+
+    size_t len = strlen(srcfile) + 1;
+    Event* e = events + events_pointer;
+    for (int i = 0; i < n; i++, e++) {
+        e->eid = 0;
+        e->tid = tid;
+        e->mem = (long) mems[i];
+        e->type = (sites[i] & 1) ? WRITE : READ;
+        memcpy(e->srcfile, srcfile, len);
+        e->lockset = 0;
+        e->synctid = 0;
+        e->cond = NULL;
+        e->line = lines[i];
+    }
+    events_pointer += n;
+}
+
 pthread_mutex_t mutex;
 pthread_mutexattr_t Attr;
 FILE* fout, *fdebug;
 
+#define BATCH_CHUNK 64
+
+/* ************************************************************************
+ * Modes, set by environment variables when the program starts
+ *   CANARY_TRACE_ONLINE=1: detect data races online, see trace.races
+ *   CANARY_TRACE_RECORD=0: do not record the trace for pecan
+ * ************************************************************************/
+int online = 0;
+int record = 1;
+OnlineDetector detector;
+
+int envFlag(const char* name, int def) {
+    const char* val = getenv(name);
+    if (!val || !*val) return def;
+    return atoi(val) != 0;
+}
+
+int envNumber(const char* name, int def) {
+    const char* val = getenv(name);
+    if (!val || !*val || atoi(val) <= 0) return def;
+    return atoi(val);
+}
+
+/* ************************************************************************
+ * Sampling of memory accesses, in the style of LiteRace
+ *   CANARY_TRACE_SAMPLING=1: sample memory accesses
+ *   CANARY_TRACE_SAMPLE_BURST=<n>: accesses recorded in a burst (10)
+ *   CANARY_TRACE_SAMPLE_MAX_PERIOD=<n>: the lowest rate is 1/n (1000)
+ *
+ * Every access site is recorded for a burst, and then its sampling rate
+ * is halved until it reaches the lowest rate. Cold sites are therefore
+ * always recorded, while hot sites back off exponentially. The state is
+ * thread-local, so that the sampled out accesses never take the mutex.
+ * Synchronizations are always recorded.
+ * ************************************************************************/
+int sampling = 0;
+unsigned sample_burst = 10;
+unsigned sample_max_period = 1000;
+
+struct SiteSampler {
+    unsigned burst; // accesses to record in the current burst
+    unsigned skip; // accesses to skip before the next burst
+    unsigned period; // 1/rate
+};
+
+pthread_key_t sampler_key;
+__thread SiteSampler* samplers = NULL;
+__thread unsigned sampler_num = 0;
+
+// whether the pre-hooks being executed are sampled, a stack of bits,
+// because the hooks of memcpy are nested
+__thread unsigned long access_stack = 0;
+
+void freeSamplers(void* p) {
+    free(p);
+}
+
+int sample(int site) {
+    if (!sampling || site < 0) return 1;
+
+    if ((unsigned) site >= sampler_num) {
+        unsigned num = sampler_num ? sampler_num : 64;
+        while (num <= (unsigned) site) num *= 2;
+
+        samplers = (SiteSampler*) realloc(samplers, num * sizeof (SiteSampler));
+        for (unsigned i = sampler_num; i < num; i++) {
+            samplers[i].burst = sample_burst;
+            samplers[i].skip = 0;
+            samplers[i].period = 1;
+        }
+        sampler_num = num;
+        pthread_setspecific(sampler_key, samplers);
+    }
+
+    SiteSampler& s = samplers[site];
+    if (s.skip) {
+        s.skip--;
+        return 0;
+    }
+
+    if (--s.burst == 0) {
+        s.burst = sample_burst;
+        if (s.period < sample_max_period) {
+            s.period = s.period * 2 < sample_max_period ? s.period * 2 : sample_max_period;
+        }
+        s.skip = (s.period - 1) * sample_burst;
+    }
+    return 1;
+}
+
+int enterAccess(int site) {
+    int sampled = sample(site);
+    access_stack = (access_stack << 1) | sampled;
+    return sampled;
+}
+
+int exitAccess() {
+    int sampled = access_stack & 1;
+    access_stack >>= 1;
+    return sampled;
+}
+
+void recordAccesses(long** mems, int* sites, long* lines, int n, const char* file) {
+    pthread_t tid = pthread_self();
+    pthread_mutex_lock(&mutex);
+
+    if (record) appendAccesses(tid, mems, sites, lines, n, file);
+    if (online) {
+        for (int i = 0; i < n; i++) {
+            if (sites[i] & 1) {
+                detector.onWrite(tid, (long) mems[i], file, lines[i]);
+            } else {
+                detector.onRead(tid, (long) mems[i], file, lines[i]);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
 void dump() {
+    if (online) {
+        detector.finish();
+    }
+
+    if (!record) {
+        return;
+    }
+
     fprintf(fdebug, "Events Number: %d\n", events_pointer);
     long outputNum = 0;
     for (int i = 0; i < events_pointer; i++) {
@@ -178,16 +327,29 @@ extern "C" {
         signal(SIGQUIT, sigroutine);
         signal(SIGKILL, sigroutine);
 
-        fout = fopen("trace.out", "wb");
-        if (!fout) {
-            printf("init fail!\n");
-            exit(-1);
+        online = envFlag("CANARY_TRACE_ONLINE", 0);
+        record = envFlag("CANARY_TRACE_RECORD", 1);
+        sampling = envFlag("CANARY_TRACE_SAMPLING", 0);
+        sample_burst = envNumber("CANARY_TRACE_SAMPLE_BURST", 10);
+        sample_max_period = envNumber("CANARY_TRACE_SAMPLE_MAX_PERIOD", 1000);
+        pthread_key_create(&sampler_key, freeSamplers);
+
+        if (record) {
+            fout = fopen("trace.out", "wb");
+            if (!fout) {
+                printf("init fail!\n");
+                exit(-1);
+            }
+
+            fdebug = fopen("trace.debug", "w+");
+            if (!fdebug) {
+                printf("init fail!\n");
+                exit(-1);
+            }
         }
 
-        fdebug = fopen("trace.debug", "w+");
-        if (!fdebug) {
-            printf("init fail!\n");
-            exit(-1);
+        if (online) {
+            detector.init("trace.races");
         }
 
 	pthread_mutexattr_init(&Attr);
@@ -209,50 +371,105 @@ extern "C" {
         return;
     }
 
-    void OnPreLoad(long* mem, long line, char * file) {
+    void OnPreLoad(long* mem, long line, char * file, int site) {
         if (!start) {
             return;
         }
 
+        if (!enterAccess(site)) {
+            return;
+        }
+
         //printf("OnPreLoad\n");
         pthread_mutex_lock(&mutex);
     }
 
-    void OnLoad(long* mem, long line, char * file) {
+    void OnLoad(long* mem, long line, char * file, int site) {
         //printf("OnLoad\n");
         if (!start) {
             return;
         }
-        
-        createEvent(0, pthread_self(), (long)mem, READ, NULL, 0, 0, NULL, file, line);
+
+        if (!exitAccess()) {
+            return;
+        }
+
+        if (record) createEvent(0, pthread_self(), (long)mem, READ, 0, NULL, file, line);
+        if (online) detector.onRead(pthread_self(), (long)mem, file, line);
 
         //test(events[events_pointer - 1].mem, events[events_pointer - 1].tid);
 
         pthread_mutex_unlock(&mutex);
     }
 
-    void OnPreStore(long* mem, long line, char * file) {
+    void OnPreStore(long* mem, long line, char * file, int site) {
         if (!start) {
             return;
         }
+
+        if (!enterAccess(site)) {
+            return;
+        }
         //printf("OnPreStore\n");
 
         pthread_mutex_lock(&mutex);
     }
 
-    void OnStore(long* mem, long line, char * file) {
+    void OnStore(long* mem, long line, char * file, int site) {
         if (!start) {
             return;
         }
-        
+
+        if (!exitAccess()) {
+            return;
+        }
+
         //printf("OnStore\n");
-        createEvent(0, pthread_self(), (long)mem, WRITE, NULL, 0, 0, NULL, file, line);
+        if (record) createEvent(0, pthread_self(), (long)mem, WRITE, 0, NULL, file, line);
+        if (online) detector.onWrite(pthread_self(), (long)mem, file, line);
 
         //test(events[events_pointer - 1].mem, events[events_pointer - 1].tid);
 
         pthread_mutex_unlock(&mutex);
     }
 
+    /// The accesses of a straight-line run in a block, recorded after the
+    /// last of them. The lowest bit of a site tells a write from a read.
+    void OnAccesses(long** mems, int* sites, long* lines, int n, char * file) {
+        if (!start) {
+            return;
+        }
+
+        // lanes of masked vector accesses are NULL if they are disabled
+        bool masked = false;
+        for (int i = 0; i < n && !masked; i++) {
+            masked = mems[i] == NULL;
+        }
+
+        if (!sampling && !masked) {
+            recordAccesses(mems, sites, lines, n, file);
+            return;
+        }
+
+        // sampled out accesses and disabled lanes are dropped before taking the mutex
+        long* kept_mems[BATCH_CHUNK];
+        int kept_sites[BATCH_CHUNK];
+        long kept_lines[BATCH_CHUNK];
+        for (int i = 0; i < n;) {
+            int kept = 0;
+            for (; i < n && kept < BATCH_CHUNK; i++) {
+                if (mems[i] != NULL && (!sampling || sample(sites[i] >> 1))) {
+                    kept_mems[kept] = mems[i];
+                    kept_sites[kept] = sites[i];
+                    kept_lines[kept++] = lines[i];
+                }
+            }
+            if (kept) {
+                recordAccesses(kept_mems, kept_sites, kept_lines, kept, file);
+            }
+        }
+    }
+
     void OnPreLock(long* mem, long line, char * file) {
         return;
     }
@@ -263,7 +480,8 @@ extern "C" {
             return;
         }
         
-        createEvent(0, pthread_self(), (long)mem, ACQUIRE, NULL, 0, 0, NULL, file, line);
+        if (record) createEvent(0, pthread_self(), (long)mem, ACQUIRE, 0, NULL, file, line);
+        if (online) detector.onAcquire(pthread_self(), (long)mem);
 
     }
 
@@ -272,7 +490,8 @@ extern "C" {
             return;
         }
         
-        createEvent(0, pthread_self(), (long)mem, RELEASE, NULL, 0, 0, NULL, file, line);
+        if (record) createEvent(0, pthread_self(), (long)mem, RELEASE, 0, NULL, file, line);
+        if (online) detector.onRelease(pthread_self(), (long)mem);
     }
 
     void OnUnlock(long *mem, long line, char * file) {
@@ -293,7 +512,8 @@ extern "C" {
             return;
         }
         
-        createEvent(0, pthread_self(), 0, FORK, NULL, 0, *((pthread_t*) tid), NULL, file, line);
+        if (record) createEvent(0, pthread_self(), 0, FORK, *((pthread_t*) tid), NULL, file, line);
+        if (online) detector.onFork(pthread_self(), *((pthread_t*) tid));
         //printf("OnFork\n");
 
         pthread_mutex_unlock(&mutex);
@@ -308,12 +528,19 @@ extern "C" {
             return;
         }
         //printf("OnJoin\n");
-        createEvent(0, pthread_self(), 0, JOIN, NULL, 0, tid, NULL, file, line);
+        if (record) createEvent(0, pthread_self(), 0, JOIN, tid, NULL, file, line);
+        if (online) detector.onJoin(pthread_self(), tid);
         
     }
 
     void OnPreWait(long* cond, long *mem, long line, char * file) {
         //printf("OnPreWait\n");
+        if (!start) {
+            return;
+        }
+
+        // waiting releases the mutex
+        if (online) detector.onRelease(pthread_self(), (long) mem);
     }
 
     void OnWait(long* cond, long *mem, long line, char * file) {
@@ -322,7 +549,8 @@ extern "C" {
         }
         //printf("OnWait\n");
         
-        createEvent(0, pthread_self(), (long) mem, WAIT, NULL, 0, 0, (pthread_cond_t*) cond, file, line);
+        if (record) createEvent(0, pthread_self(), (long) mem, WAIT, 0, (pthread_cond_t*) cond, file, line);
+        if (online) detector.onWait(pthread_self(), (long) cond, (long) mem);
     }
 
     void OnPreNotify(long* cond, long *mem, long line, char * file) {
@@ -339,7 +567,8 @@ extern "C" {
         }
         //printf("OnNotify\n");
         
-        createEvent(0, pthread_self(), (long) mem, NOTIFY, NULL, 0, 0, (pthread_cond_t*) cond, file, line);
+        if (record) createEvent(0, pthread_self(), (long) mem, NOTIFY, 0, (pthread_cond_t*) cond, file, line);
+        if (online) detector.onNotify(pthread_self(), (long) cond);
 
         pthread_mutex_unlock(&mutex);
     }
@@ -7,6 +7,7 @@
  */
 
 #include "Transformer/Transformer.h"
+#include "DyckAA/Progress.h"
 #include <llvm/Support/Debug.h>
 #include <list>
 
@@ -124,21 +125,21 @@ CallInst* Transformer::insertCallInstAtTail(Function* theFunc, Function* tocall,
     return NULL;
 }
 
-void Transformer::transform(Module* module, AliasAnalysis* AAptr) {
-    AliasAnalysis& AA = *AAptr;
+void Transformer::transform(Module* module, DyckAliasAnalysis& AA) {
     this->beforeTransform(module, AA);
 
-    unsigned functionsNum = module->getFunctionList().size();
-    unsigned handledNum = 0;
-
+    vector<Function*> functions;
     for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
-        Function& f = *iterF;
-        if (!this->functionToTransform(module, &f)) {
-            outs() << "Remaining... " << (functionsNum - handledNum++) << " functions             \r";
-            continue;
+        if (this->functionToTransform(module, iterF)) {
+            functions.push_back(iterF);
         }
+    }
 
-        outs() << "Remaining... " << (functionsNum - handledNum++) << " functions             \r";
+    Progress progress("Transforming functions", functions.size());
+
+    for (unsigned fi = 0; fi < functions.size(); fi++) {
+        Function& f = *functions[fi];
+        progress.step();
 
         bool allocHasHandled = false;
         vector<AllocaInst*> allocas;
@@ -202,13 +203,13 @@ void Transformer::transform(Module* module, AliasAnalysis* AAptr) {
                     if (isa<Function>(calledValue)) {
                         handleCalls(module, (CallInst*) & inst, (Function*) calledValue, AA);
                     } else if (calledValue->getType()->isPointerTy()) {
-                        Call * c = ((DyckAliasAnalysis*) & AA)->getCallGraph()->getOrInsertFunction(&f)->getCall(&call);
+                        Call * c = AA.getCallGraph()->getOrInsertFunction(&f)->getCall(&call);
                         if (c != NULL) {
                             if (isa<Function>(c->calledValue)) {
                                 handleCalls(module, (CallInst*) & inst, (Function*) (c->calledValue), AA);
                             } else {
-                                set<Function*>& may = ((PointerCall*) c)->mayAliasedCallees;
-                                set<Function*>::iterator it = may.begin();
+                                SetVector<Function*>& may = ((PointerCall*) c)->mayAliasedCallees;
+                                SetVector<Function*>::iterator it = may.begin();
                                 while (it != may.end()) {
                                     Function* cf = *it;
                                     handleCalls(module, (CallInst*) & inst, cf, AA);
@@ -224,11 +225,38 @@ void Transformer::transform(Module* module, AliasAnalysis* AAptr) {
         }
     }
 
-    outs() << "                                                            \r";
+    progress.finish();
 
     this->afterTransform(module, AA);
 }
 
+int Transformer::getValueIndex(Module* module, Value* v, AliasAnalysis & AA) {
+    auto it = valueIndexCache.find(v);
+    if (it != valueIndexCache.end()) {
+        return it->second;
+    }
+
+    int idx = this->computeValueIndex(v);
+    valueIndexCache[v] = idx;
+    return idx;
+}
+
+bool Transformer::isMaskedVectorAccess(CallInst* call) {
+    Function* f = call->getCalledFunction();
+    if (f == NULL || call->getNumArgOperands() != 4) {
+        return false;
+    }
+
+    switch (f->getIntrinsicID()) {
+        case Intrinsic::masked_load:
+        case Intrinsic::masked_store:
+            return true;
+        default:
+            // gathers and scatters are not known by LLVM 3.6
+            return f->getName().startswith("llvm.masked.gather.") || f->getName().startswith("llvm.masked.scatter.");
+    }
+}
+
 bool Transformer::handleCalls(Module* module, CallInst* call, Function* calledFunction, AliasAnalysis & AA) {
     Function &cf = *calledFunction;
     // fork & join
@@ -298,7 +326,11 @@ bool Transformer::handleCalls(Module* module, CallInst* call, Function* calledFu
             }
                 break;
             default:
-                transformOtherIntrinsics(module, call, AA);
+                if (isMaskedVectorAccess(call)) {
+                    transformMaskedVectorAccess(module, call, AA);
+                } else {
+                    transformOtherIntrinsics(module, call, AA);
+                }
                 break;
         }
         return true;
@@ -108,6 +108,21 @@ void Transformer4Leap::transformStoreInst(Module* module, StoreInst* inst, Alias
     this->insertCallInstAfter(inst, F_store, tmp, debug_idx, NULL);
 }
 
+void Transformer4Leap::transformMaskedVectorAccess(Module* module, CallInst* call, AliasAnalysis& AA) {
+    // load/gather(ptr, align, mask, passthru), store/scatter(value, ptr, align, mask);
+    // the lanes of a gather or a scatter are in the alias set of its vector of pointers
+    bool write = call->getType()->isVoidTy();
+    Value * val = call->getArgOperand(write ? 1 : 0);
+    int svIdx = this->getValueIndex(module, val, AA);
+    if (svIdx == -1) return;
+
+    ConstantInt* tmp = ConstantInt::get(Type::getIntNTy(module->getContext(), INT_BIT_SIZE), svIdx);
+    ConstantInt* debug_idx = ConstantInt::get(Type::getIntNTy(module->getContext(), INT_BIT_SIZE), stmt_idx++);
+
+    this->insertCallInstBefore(call, write ? F_prestore : F_preload, tmp, debug_idx, NULL);
+    this->insertCallInstAfter(call, write ? F_store : F_load, tmp, debug_idx, NULL);
+}
+
 void Transformer4Leap::transformPthreadCreate(Module* module, CallInst* ins, AliasAnalysis& AA) {
     ConstantInt* tmp = ConstantInt::get(Type::getIntNTy(module->getContext(), INT_BIT_SIZE), -1);
     this->insertCallInstBefore(ins, F_prefork, tmp, NULL);
@@ -315,7 +330,7 @@ bool Transformer4Leap::isInstrumentationFunction(Module* module, Function * call
 
 // private functions
 
-int Transformer4Leap::getValueIndex(Module* module, Value* v, AliasAnalysis & AA) {
+int Transformer4Leap::computeValueIndex(Value* v) {
     v = v->stripPointerCastsNoFollowAliases();
     while (isa<GlobalAlias>(v)) {
         // aliase can be either global or bitcast of global
@@ -347,7 +362,7 @@ bool Transformer4Leap::runOnModule(Module& M) {
         AA.getEscapedPointersTo(&sharedVariables, PThreadCreate);
     }
 
-    this->transform(&M, &AA);
+    this->transform(&M, AA);
 
     outs() << "\nPleaase add -ltsxleaprecord or -lleaprecord / -lleapreplay for record / replay when you compile the transformed bitcode file to an executable file.\n";
     return true;
@@ -4,17 +4,34 @@
  */
 
 #include "Transformer/Transformer4Trace.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/CFG.h"
 
 #define POINTER_BIT_SIZE ptrsize*8
 
 #define FUNCTION_VOID_ARG_TYPE Type::getVoidTy(context),(Type*)0
 #define FUNCTION_MEM_LN_ARG_TYPE Type::getVoidTy(context),Type::getIntNPtrTy(context,POINTER_BIT_SIZE),Type::getIntNTy(context,POINTER_BIT_SIZE),Type::getInt8PtrTy(context,0),(Type*)0
+#define FUNCTION_MEM_LN_SITE_ARG_TYPE Type::getVoidTy(context),Type::getIntNPtrTy(context,POINTER_BIT_SIZE),Type::getIntNTy(context,POINTER_BIT_SIZE),Type::getInt8PtrTy(context,0),Type::getInt32Ty(context),(Type*)0
 #define FUNCTION_TID_LN_ARG_TYPE Type::getVoidTy(context),Type::getIntNTy(context,POINTER_BIT_SIZE),Type::getIntNTy(context,POINTER_BIT_SIZE),Type::getInt8PtrTy(context,0),(Type*)0
+#define FUNCTION_MEMS_SITES_LNS_ARG_TYPE Type::getVoidTy(context),PointerType::getUnqual(Type::getIntNPtrTy(context,POINTER_BIT_SIZE)),Type::getInt32PtrTy(context),Type::getIntNPtrTy(context,POINTER_BIT_SIZE),Type::getInt32Ty(context),Type::getInt8PtrTy(context,0),(Type*)0
 #define FUNCTION_2MEM_LN_ARG_TYPE Type::getVoidTy(context),Type::getIntNPtrTy(context,POINTER_BIT_SIZE),Type::getIntNPtrTy(context,POINTER_BIT_SIZE),Type::getIntNTy(context,POINTER_BIT_SIZE),Type::getInt8PtrTy(context,0),(Type*)0
 
+static cl::opt<bool> TraceAllAccesses("trace-all-accesses", cl::init(false), cl::Hidden,
+        cl::desc("Do not filter out the sequential accesses and the reads of read-only shared variables."));
+
+static cl::list<std::string> TraceAllowList("trace-allow", cl::CommaSeparated, cl::Hidden,
+        cl::desc("Only instrument the accesses in these functions or source files."));
+
+static cl::list<std::string> TraceDenyList("trace-deny", cl::CommaSeparated, cl::Hidden,
+        cl::desc("Do not instrument the accesses in these functions or source files."));
+
+static cl::opt<unsigned> TraceBatchSize("trace-batch", cl::init(16), cl::Hidden,
+        cl::desc("The max number of accesses of a straight-line run recorded by one hook; 1 records each access separately."));
+
 char Transformer4Trace::ID = 0;
 
-Transformer4Trace::Transformer4Trace() : ModulePass(ID)  { 
+Transformer4Trace::Transformer4Trace() : ModulePass(ID), filtering(false), site_num(0), batch_num(0) { 
 }
 
 bool Transformer4Trace::debug() {
@@ -36,11 +53,11 @@ void Transformer4Trace::beforeTransform(Module* module, AliasAnalysis& AA) {
     //F_thread_init = cast<Function>(m->getOrInsertFunction("OnThreadInit", FUNCTION_ARG_TYPE));
     //F_thread_exit = cast<Function>(m->getOrInsertFunction("OnThreadExit", FUNCTION_ARG_TYPE));
 
-    F_preload = cast<Function>(m->getOrInsertFunction("OnPreLoad", FUNCTION_MEM_LN_ARG_TYPE));
-    F_load = cast<Function>(m->getOrInsertFunction("OnLoad", FUNCTION_MEM_LN_ARG_TYPE));
+    F_preload = cast<Function>(m->getOrInsertFunction("OnPreLoad", FUNCTION_MEM_LN_SITE_ARG_TYPE));
+    F_load = cast<Function>(m->getOrInsertFunction("OnLoad", FUNCTION_MEM_LN_SITE_ARG_TYPE));
 
-    F_prestore = cast<Function>(m->getOrInsertFunction("OnPreStore", FUNCTION_MEM_LN_ARG_TYPE));
-    F_store = cast<Function>(m->getOrInsertFunction("OnStore", FUNCTION_MEM_LN_ARG_TYPE));
+    F_prestore = cast<Function>(m->getOrInsertFunction("OnPreStore", FUNCTION_MEM_LN_SITE_ARG_TYPE));
+    F_store = cast<Function>(m->getOrInsertFunction("OnStore", FUNCTION_MEM_LN_SITE_ARG_TYPE));
 
     F_prelock = cast<Function>(m->getOrInsertFunction("OnPreLock", FUNCTION_MEM_LN_ARG_TYPE));
     F_lock = cast<Function>(m->getOrInsertFunction("OnLock", FUNCTION_MEM_LN_ARG_TYPE));
@@ -59,48 +76,25 @@ void Transformer4Trace::beforeTransform(Module* module, AliasAnalysis& AA) {
 
     F_prewait = cast<Function>(m->getOrInsertFunction("OnPreWait", FUNCTION_2MEM_LN_ARG_TYPE));
     F_wait = cast<Function>(m->getOrInsertFunction("OnWait", FUNCTION_2MEM_LN_ARG_TYPE));
+
+    F_accesses = cast<Function>(m->getOrInsertFunction("OnAccesses", FUNCTION_MEMS_SITES_LNS_ARG_TYPE));
     
     if (debug()) {
-        errs() << "Start Preprocessing...\n";
+        errs() << "Start Filtering...\n";
         errs().flush();
     }
-    for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
-        Function& f = *iterF;
-        bool ignored = true;
-        for (ilist_iterator<BasicBlock> iterB = f.getBasicBlockList().begin(); iterB != f.getBasicBlockList().end(); iterB++) {
-            BasicBlock &b = *iterB;
-            for (ilist_iterator<Instruction> iterI = b.getInstList().begin(); iterI != b.getInstList().end(); iterI++) {
-                Instruction &inst = *iterI;
- //               std::string &filename=getInstructionFileName(&inst) ;
-//                unsigned ln = LOC.getLineNumber();
-//                errs() << inst << "\n";
-//                errs() << f.getName() << "\n";
-//                errs() << filename; 
-//                errs() << " : " << ln << "\n";
-//                errs() <<"************************"<< "\n";
-//                errs().flush();
-                //if (filename == "pbzip2.cpp") {
-                    ignored = false;
-                    break;
-                //}
-            }
-            if (!ignored) {
-                break;
-            }
-        }
 
-        if (ignored) {
-            ignored_funcs.insert(&f);
-        }
-    }
+    this->filterAccesses(module, *((DyckAliasAnalysis*) & AA));
 
     if (debug()) {
-        errs() << "End Preprocessing...\n";
+        errs() << "End Filtering...\n";
         errs().flush();
     }
 }
 
 void Transformer4Trace::afterTransform(Module* module, AliasAnalysis& AA) {
+    this->flushBatch(module);
+
     Function * mainFunction = module->getFunction("main");
     if (mainFunction != NULL) {
         this->insertCallInstAtHead(mainFunction, F_init, NULL);
@@ -111,28 +105,46 @@ void Transformer4Trace::afterTransform(Module* module, AliasAnalysis& AA) {
 void Transformer4Trace::transformLoadInst(Module* module, LoadInst* inst, AliasAnalysis& AA) {
     Value * val = inst->getOperand(0);
     int svIdx = this->getValueIndex(module, val, AA);
-    if (svIdx == -1) return;
+    if (!this->accessToTransform(inst, svIdx, false)) return;
 
-    CastInst* c = CastInst::CreatePointerCast(val, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
-    c->insertBefore(inst);
     Value* lnval = getOtInsertLineNumberValue(module, inst);
+    Value* siteval = getNewSiteValue(module);
+    if (inst->getType()->isVectorTy()) {
+        this->batchVectorAccess(module, inst, val, NULL, lnval, siteval, false);
+        return;
+    }
 
-    this->insertCallInstBefore(inst, F_preload, c, lnval, getOrInsertSrcFileNameValue(module, inst), NULL);
-    this->insertCallInstAfter(inst, F_load, c, lnval, getOrInsertSrcFileNameValue(module, inst), NULL);
+    CastInst* c = CastInst::CreatePointerCast(val, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
+    c->insertBefore(inst);
+    this->batchAccess(module, inst, c, lnval, siteval, false);
 }
 
 void Transformer4Trace::transformStoreInst(Module* module, StoreInst* inst, AliasAnalysis& AA) {
     Value * val = inst->getOperand(1);
     int svIdx = this->getValueIndex(module, val, AA);
-    if (svIdx == -1) return;
+    if (!this->accessToTransform(inst, svIdx, true)) return;
+
+    Value* lnval = getOtInsertLineNumberValue(module, inst);
+    Value* siteval = getNewSiteValue(module);
+    if (inst->getValueOperand()->getType()->isVectorTy()) {
+        this->batchVectorAccess(module, inst, val, NULL, lnval, siteval, true);
+        return;
+    }
 
     CastInst* c = CastInst::CreatePointerCast(val, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
     c->insertBefore(inst);
+    this->batchAccess(module, inst, c, lnval, siteval, true);
+}
 
-    Value* lnval = getOtInsertLineNumberValue(module, inst);
+void Transformer4Trace::transformMaskedVectorAccess(Module* module, CallInst* call, AliasAnalysis& AA) {
+    bool write = call->getType()->isVoidTy();
+    Value * val = call->getArgOperand(write ? 1 : 0);
+    int svIdx = this->getValueIndex(module, val, AA);
+    if (!this->accessToTransform(call, svIdx, write)) return;
 
-    this->insertCallInstBefore(inst, F_prestore, c, lnval, getOrInsertSrcFileNameValue(module, inst), NULL);
-    this->insertCallInstAfter(inst, F_store, c, lnval, getOrInsertSrcFileNameValue(module, inst), NULL);
+    Value* lnval = getOtInsertLineNumberValue(module, call);
+    Value* siteval = getNewSiteValue(module);
+    this->batchVectorAccess(module, call, val, call->getArgOperand(write ? 3 : 2), lnval, siteval, write);
 }
 
 void Transformer4Trace::transformPthreadCreate(Module* module, CallInst* call, AliasAnalysis& AA) {
@@ -233,6 +245,8 @@ void Transformer4Trace::transformMemCpyMov(Module* module, CallInst* call, Alias
     Value * src = call->getArgOperand(1);
     int svIdx_dst = this->getValueIndex(module, dst, AA);
     int svIdx_src = this->getValueIndex(module, src, AA);
+    if (!this->accessToTransform(call, svIdx_dst, true)) svIdx_dst = -1;
+    if (!this->accessToTransform(call, svIdx_src, false)) svIdx_src = -1;
     if (svIdx_dst == -1 && svIdx_src == -1) {
         return;
     } else if (svIdx_dst != -1 && svIdx_src != -1) {
@@ -245,29 +259,34 @@ void Transformer4Trace::transformMemCpyMov(Module* module, CallInst* call, Alias
         if (svIdx_dst != svIdx_src) {
 
 
-            insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-            insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+            Value* dstsiteval = getNewSiteValue(module);
+            insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), dstsiteval, NULL);
+            insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), dstsiteval, NULL);
 
-            insertCallInstBefore(call, F_preload, s, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-            insertCallInstAfter(call, F_load, s, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+            Value* srcsiteval = getNewSiteValue(module);
+            insertCallInstBefore(call, F_preload, s, lnval, getOrInsertSrcFileNameValue(module, call), srcsiteval, NULL);
+            insertCallInstAfter(call, F_load, s, lnval, getOrInsertSrcFileNameValue(module, call), srcsiteval, NULL);
 
         } else {
-            insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-            insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+            Value* siteval = getNewSiteValue(module);
+            insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
+            insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
         }
 
     } else if (svIdx_dst != -1) {
         CastInst* d = CastInst::CreatePointerCast(dst, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
         d->insertBefore(call);
 
-        insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-        insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+        Value* siteval = getNewSiteValue(module);
+        insertCallInstBefore(call, F_prestore, d, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
+        insertCallInstAfter(call, F_store, d, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
     } else {
         CastInst* s = CastInst::CreatePointerCast(src, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
         s->insertBefore(call);
 
-        insertCallInstBefore(call, F_preload, s, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-        insertCallInstAfter(call, F_load, s, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+        Value* siteval = getNewSiteValue(module);
+        insertCallInstBefore(call, F_preload, s, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
+        insertCallInstAfter(call, F_load, s, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
     }
 }
 
@@ -276,13 +295,14 @@ void Transformer4Trace::transformMemSet(Module* module, CallInst* call, AliasAna
 
     Value * val = call->getArgOperand(0);
     int svIdx = this->getValueIndex(module, val, AA);
-    if (svIdx == -1) return;
+    if (!this->accessToTransform(call, svIdx, true)) return;
 
     CastInst* c = CastInst::CreatePointerCast(val, Type::getIntNPtrTy(module->getContext(),POINTER_BIT_SIZE));
     c->insertBefore(call);
 
-    insertCallInstBefore(call, F_prestore, c, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-    insertCallInstAfter(call, F_store, c, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+    Value* siteval = getNewSiteValue(module);
+    insertCallInstBefore(call, F_prestore, c, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
+    insertCallInstAfter(call, F_store, c, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
 }
 
 void Transformer4Trace::transformOtherFunctionCalls(Module* module, CallInst* call, AliasAnalysis& AA) {
@@ -300,15 +320,16 @@ void Transformer4Trace::transformOtherFunctionCalls(Module* module, CallInst* ca
         }
 
         int svIdx = this->getValueIndex(module, arg, AA);
-        if (svIdx != -1) {
-            insertCallInstBefore(call, F_prestore, c, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
-            insertCallInstBefore(call, F_store, c, lnval, getOrInsertSrcFileNameValue(module, call), NULL);
+        if (this->accessToTransform(call, svIdx, true)) {
+            Value* siteval = getNewSiteValue(module);
+            insertCallInstBefore(call, F_prestore, c, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
+            insertCallInstBefore(call, F_store, c, lnval, getOrInsertSrcFileNameValue(module, call), siteval, NULL);
         }
     }
 }
 
 bool Transformer4Trace::functionToTransform(Module* module, Function* f) {
-    return !f->empty() && ignored_funcs.find(f) == ignored_funcs.end() && !this->isInstrumentationFunction(module, f) && !f->isIntrinsic();
+    return !f->empty() && !this->isInstrumentationFunction(module, f) && !f->isIntrinsic();
 }
 
 bool Transformer4Trace::blockToTransform(Module* module, BasicBlock* bb) {
@@ -328,12 +349,453 @@ bool Transformer4Trace::isInstrumentationFunction(Module* module, Function* call
             || called == F_prefork || called == F_fork
             || called == F_prejoin || called == F_join
             || called == F_prenotify || called == F_notify
-            || called == F_prewait || called == F_wait;
+            || called == F_prewait || called == F_wait
+            || called == F_accesses;
 }
 
 // private functions
 
-int Transformer4Trace::getValueIndex(Module* module, Value* v, AliasAnalysis & AA) {
+typedef vector<pair<Instruction*, Function*> > CallEdges; // call inst, callee
+
+static void getCallEdges(DyckCallGraphNode* node, CallEdges& edges) {
+    vector<CommonCall*>& commonCalls = node->getCommonCalls();
+    for (auto& c : commonCalls) {
+        edges.push_back(make_pair(c->instruction, (Function*) c->calledValue));
+    }
+
+    vector<PointerCall*>& pointerCalls = node->getPointerCalls();
+    for (auto& c : pointerCalls) {
+        for (auto& f : c->mayAliasedCallees) {
+            edges.push_back(make_pair(c->instruction, f));
+        }
+    }
+}
+
+/// callers = the functions that may call target directly or indirectly
+static void getTransitiveCallers(map<Function*, CallEdges>& calls, Function* target, set<Function*>& callers) {
+    if (target == NULL) {
+        return;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& fc : calls) {
+            if (callers.count(fc.first)) {
+                continue;
+            }
+            for (auto& e : fc.second) {
+                if (e.second == target || callers.count(e.second)) {
+                    callers.insert(fc.first);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/// Whether the join must join the thread of the fork, i.e. the handle of the
+/// thread is a local variable only written by the fork, and the join loads it.
+static bool joinsThread(Instruction* fork, Instruction* join) {
+    Function* create = ((CallInst*) fork)->getCalledFunction();
+    Function* joined = ((CallInst*) join)->getCalledFunction();
+    if (create == NULL || create->getName() != "pthread_create" || joined == NULL || joined->getName() != "pthread_join") {
+        return false;
+    }
+
+    Value* handle = ((CallInst*) fork)->getArgOperand(0)->stripPointerCasts();
+    LoadInst* load = dyn_cast<LoadInst>(((CallInst*) join)->getArgOperand(0));
+    if (!isa<AllocaInst>(handle) || load == NULL || load->getPointerOperand()->stripPointerCasts() != handle) {
+        return false;
+    }
+
+    for (auto uit = handle->user_begin(); uit != handle->user_end(); uit++) {
+        if (*uit != fork && !isa<LoadInst>(*uit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// A block is parallel if it is reachable from a fork. Only if there is one
+/// fork, which is not in a loop, the blocks after the joins of its thread are
+/// not, since another thread may be forked by a callee, or not joined on an
+/// early exit or at all, e.g. a detached one.
+static void getParallelBlocks(vector<Instruction*>& forks, vector<Instruction*>& joins, set<BasicBlock*>& parallel) {
+    vector<BasicBlock*> worklist;
+    set<BasicBlock*> barriers;
+    if (forks.size() == 1) {
+        BasicBlock* forkBlock = forks[0]->getParent();
+        for (auto& join : joins) {
+            if (join->getParent() != forkBlock && joinsThread(forks[0], join)) {
+                barriers.insert(join->getParent());
+            }
+        }
+
+        // the fork in a loop forks more than one thread
+        set<BasicBlock*> reached;
+        worklist.insert(worklist.end(), succ_begin(forkBlock), succ_end(forkBlock));
+        while (!worklist.empty()) {
+            BasicBlock* bb = worklist.back();
+            worklist.pop_back();
+            if (bb == forkBlock) {
+                barriers.clear();
+                worklist.clear();
+                break;
+            }
+            if (reached.insert(bb).second) {
+                worklist.insert(worklist.end(), succ_begin(bb), succ_end(bb));
+            }
+        }
+    }
+
+    for (auto& fork : forks) {
+        worklist.push_back(fork->getParent());
+        while (!worklist.empty()) {
+            BasicBlock* bb = worklist.back();
+            worklist.pop_back();
+            if (!parallel.insert(bb).second || barriers.count(bb)) {
+                continue;
+            }
+            for (succ_iterator sit = succ_begin(bb); sit != succ_end(bb); sit++) {
+                worklist.push_back(*sit);
+            }
+        }
+    }
+}
+
+static bool isListed(cl::list<std::string>& list, Function* f) {
+    std::string filename;
+    for (inst_iterator it = inst_begin(f); it != inst_end(f); it++) {
+        MDNode* md = it->getMetadata("dbg");
+        if (md != NULL) {
+            filename = DILocation(md).getFilename();
+            break;
+        }
+    }
+
+    for (unsigned i = 0; i < list.size(); i++) {
+        const std::string& name = list[i];
+        if (f->getName() == name || filename == name) {
+            return true;
+        }
+        // a file name without directories
+        if (filename.size() > name.size() && filename[filename.size() - name.size() - 1] == '/'
+                && filename.compare(filename.size() - name.size(), name.size(), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Transformer4Trace::filterAccesses(Module* module, DyckAliasAnalysis& AA) {
+    for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
+        Function* f = iterF;
+        if (f->empty()) {
+            continue;
+        }
+        if ((!TraceAllowList.empty() && !isListed(TraceAllowList, f)) || isListed(TraceDenyList, f)) {
+            unlisted_funcs.insert(f);
+        }
+    }
+
+    Function* createFunction = module->getFunction("pthread_create");
+    if (TraceAllAccesses || createFunction == NULL || !AA.callGraphPreserved()) {
+        return;
+    }
+    filtering = true;
+
+    map<Function*, CallEdges> calls;
+    DyckCallGraph* cg = AA.getCallGraph();
+    for (auto cgIt = cg->begin(); cgIt != cg->end(); cgIt++) {
+        getCallEdges(*cgIt, calls[(*cgIt)->getLLVMFunction()]);
+    }
+
+    set<Function*> forkers, joiners;
+    getTransitiveCallers(calls, createFunction, forkers);
+    getTransitiveCallers(calls, module->getFunction("pthread_join"), joiners);
+
+    // the roots of parallel code: thread routines, i.e. the implicit calls
+    // of pthread_create, and the functions that are never called, e.g.
+    // constructors and signal handlers, except main
+    vector<Function*> worklist;
+    set<Function*> called;
+    for (auto& fc : calls) {
+        for (auto& e : fc.second) {
+            called.insert(e.second);
+            if (fc.first == createFunction && e.first == NULL) {
+                worklist.push_back(e.second);
+            }
+        }
+    }
+    for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
+        Function* f = iterF;
+        if (!f->empty() && !called.count(f) && f->getName() != "main") {
+            worklist.push_back(f);
+        }
+    }
+
+    set<Function*> partitioned;
+    while (!worklist.empty()) {
+        while (!worklist.empty()) {
+            Function* f = worklist.back();
+            worklist.pop_back();
+            if (!concurrent_funcs.insert(f).second) {
+                continue;
+            }
+            for (auto& e : calls[f]) {
+                worklist.push_back(e.second);
+            }
+        }
+
+        // functions that fork threads but do not run in parallel
+        // themselves, e.g. main, are partly parallel
+        for (auto& f : forkers) {
+            if (f->empty() || concurrent_funcs.count(f) || !partitioned.insert(f).second) {
+                continue;
+            }
+
+            // a call site of more than one callee is one fork
+            set<Instruction*> forkSet, joinSet;
+            vector<Instruction*> forks, joins;
+            set<BasicBlock*> parallel;
+            for (auto& e : calls[f]) {
+                if (e.first == NULL) {
+                    continue;
+                }
+                if ((e.second == createFunction || forkers.count(e.second)) && forkSet.insert(e.first).second) {
+                    forks.push_back(e.first);
+                }
+                if ((e.second->getName() == "pthread_join" || joiners.count(e.second)) && joinSet.insert(e.first).second) {
+                    joins.push_back(e.first);
+                }
+            }
+            getParallelBlocks(forks, joins, parallel);
+            parallel_blocks.insert(parallel.begin(), parallel.end());
+
+            for (auto& e : calls[f]) {
+                if (e.first != NULL && parallel.count(e.first->getParent())) {
+                    worklist.push_back(e.second);
+                }
+            }
+        }
+    }
+
+    // shared variables written in parallel code; calls to the functions
+    // without bodies are assumed to write their pointer arguments
+    for (ilist_iterator<Function> iterF = module->getFunctionList().begin(); iterF != module->getFunctionList().end(); iterF++) {
+        Function* f = iterF;
+        if (f->empty() || this->isInstrumentationFunction(module, f)) {
+            continue;
+        }
+        bool concurrent = concurrent_funcs.count(f);
+
+        for (inst_iterator it = inst_begin(f); it != inst_end(f); it++) {
+            Instruction* inst = &*it;
+            if (!concurrent && !parallel_blocks.count(inst->getParent())) {
+                continue;
+            }
+
+            if (isa<StoreInst>(inst)) {
+                written_vars.insert(this->getValueIndex(module, inst->getOperand(1), AA));
+            } else if (isa<AtomicRMWInst>(inst)) {
+                written_vars.insert(this->getValueIndex(module, ((AtomicRMWInst*) inst)->getPointerOperand(), AA));
+            } else if (isa<AtomicCmpXchgInst>(inst)) {
+                written_vars.insert(this->getValueIndex(module, ((AtomicCmpXchgInst*) inst)->getPointerOperand(), AA));
+            } else if (isa<MemIntrinsic>(inst)) {
+                written_vars.insert(this->getValueIndex(module, ((MemIntrinsic*) inst)->getRawDest(), AA));
+            } else if (isa<IntrinsicInst>(inst) && isMaskedVectorAccess((CallInst*) inst) && inst->getType()->isVoidTy()) {
+                written_vars.insert(this->getValueIndex(module, ((CallInst*) inst)->getArgOperand(1), AA));
+            } else if (isa<CallInst>(inst) && !isa<IntrinsicInst>(inst)) {
+                CallInst* call = (CallInst*) inst;
+                Function* callee = call->getCalledFunction();
+                if (callee != NULL && (!callee->empty() || callee->getName().startswith("pthread"))) {
+                    continue;
+                }
+                for (unsigned i = 0; i < call->getNumArgOperands(); i++) {
+                    if (call->getArgOperand(i)->getType()->isPointerTy()) {
+                        written_vars.insert(this->getValueIndex(module, call->getArgOperand(i), AA));
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool Transformer4Trace::accessToTransform(Instruction* inst, int svIdx, bool write) {
+    if (svIdx == -1) {
+        return false;
+    }
+
+    Function* f = inst->getParent()->getParent();
+    bool transform = !unlisted_funcs.count(f);
+    if (transform && filtering) {
+        transform = concurrent_funcs.count(f) || parallel_blocks.count(inst->getParent());
+        transform = transform && (write || written_vars.count(svIdx));
+    }
+
+    if (!transform) {
+        filtered_insts.insert(inst);
+    }
+    return transform;
+}
+
+void Transformer4Trace::batchAccess(Module* module, Instruction* inst, Value* mem, Value* line, Value* site, bool write) {
+    if (!batch.empty()) {
+        Instruction* last = batch.back().inst;
+        bool barrier = last->getParent() != inst->getParent() || batch.size() >= TraceBatchSize
+                || getOrInsertSrcFileNameValue(module, last) != getOrInsertSrcFileNameValue(module, inst);
+        // the lanes of a vector access are of the same instruction
+        for (Instruction* i = last->getNextNode(); !barrier && last != inst && i != inst; i = i->getNextNode()) {
+            barrier = this->isBatchBarrier(i);
+        }
+        if (barrier) {
+            this->flushBatch(module);
+        }
+    }
+
+    BatchedAccess access = {inst, mem, line, site, write};
+    batch.push_back(access);
+
+    if (TraceBatchSize <= 1) {
+        this->flushBatch(module);
+    }
+}
+
+/// The lanes of a vector access, whose pointer is a pointer to a vector or a
+/// vector of pointers, are batched as accesses of the same site; the address
+/// of a lane disabled by the mask is NULL.
+void Transformer4Trace::batchVectorAccess(Module* module, Instruction* inst, Value* ptr, Value* mask, Value* line, Value* site, bool write) {
+    LLVMContext& context = module->getContext();
+    PointerType* memTy = Type::getIntNPtrTy(context, POINTER_BIT_SIZE);
+    Type* idxTy = Type::getInt32Ty(context);
+
+    VectorType* vecTy = dyn_cast<VectorType>(ptr->getType());
+    Value* elmtPtr = NULL;
+    if (vecTy == NULL) {
+        // lanes of a vector in memory are indexed by a pointer to its element
+        vecTy = (VectorType*) ((PointerType*) ptr->getType())->getElementType();
+        unsigned as = ((PointerType*) ptr->getType())->getAddressSpace();
+        CastInst* c = CastInst::CreatePointerCast(ptr, PointerType::get(vecTy->getElementType(), as));
+        c->insertBefore(inst);
+        elmtPtr = c;
+    }
+
+    for (unsigned i = 0; i < vecTy->getNumElements(); i++) {
+        Constant* lane = ConstantInt::get(idxTy, i);
+
+        // a lane is skipped if it is disabled by a constant mask
+        Constant* enabled = mask && isa<Constant>(mask) ? ((Constant*) mask)->getAggregateElement(lane) : NULL;
+        if (enabled && enabled->isNullValue()) {
+            continue;
+        }
+
+        Instruction* addr;
+        if (elmtPtr != NULL) {
+            Value* idx[] = {lane};
+            addr = GetElementPtrInst::CreateInBounds(elmtPtr, idx);
+        } else {
+            addr = ExtractElementInst::Create(ptr, lane);
+        }
+        addr->insertBefore(inst);
+        Instruction* mem = CastInst::CreatePointerCast(addr, memTy);
+        mem->insertBefore(inst);
+
+        if (mask && !(enabled && enabled->isAllOnesValue())) {
+            Instruction* bit = ExtractElementInst::Create(mask, lane);
+            bit->insertBefore(inst);
+            mem = SelectInst::Create(bit, mem, ConstantPointerNull::get(memTy));
+            mem->insertBefore(inst);
+        }
+        this->batchAccess(module, inst, mem, line, site, write);
+    }
+}
+
+bool Transformer4Trace::isBatchBarrier(Instruction* inst) {
+    // calls may synchronize or have their own hooks, e.g. memcpy
+    if (isa<CallInst>(inst)) {
+        return !isa<IntrinsicInst>(inst) || isa<MemIntrinsic>(inst);
+    }
+    return isa<FenceInst>(inst) || isa<AtomicRMWInst>(inst) || isa<AtomicCmpXchgInst>(inst);
+}
+
+void Transformer4Trace::flushBatch(Module* module) {
+    if (batch.empty()) {
+        return;
+    }
+
+    Instruction* last = batch.back().inst;
+    Value* file = getOrInsertSrcFileNameValue(module, last);
+
+    // a lane of a masked access may be NULL, which only OnAccesses skips
+    if (batch.size() == 1 && !isa<CallInst>(last)) {
+        BatchedAccess& a = batch.back();
+        this->insertCallInstBefore(a.inst, a.write ? F_prestore : F_preload, a.mem, a.line, file, a.site, NULL);
+        this->insertCallInstAfter(a.inst, a.write ? F_store : F_load, a.mem, a.line, file, a.site, NULL);
+        batch.clear();
+        return;
+    }
+
+    LLVMContext& context = module->getContext();
+    Type* memTy = Type::getIntNPtrTy(context, POINTER_BIT_SIZE);
+    Type* lineTy = Type::getIntNTy(context, POINTER_BIT_SIZE);
+    Constant* zero = ConstantInt::get(lineTy, 0);
+
+    // one buffer of addresses per function, in the entry block
+    Function* f = last->getParent()->getParent();
+    AllocaInst*& buffer = batchBuffers[f];
+    if (buffer == NULL) {
+        buffer = new AllocaInst(ArrayType::get(memTy, TraceBatchSize), "trace_batch", &*f->getEntryBlock().getFirstInsertionPt());
+    }
+
+    // addresses are stored into the buffer after the last access, where
+    // all of them are available; sites and lines are constant arrays,
+    // and the lowest bit of a site tells a write from a read
+    vector<Constant*> sites, lines;
+    Instruction* pos = last;
+    for (unsigned i = 0; i < batch.size(); i++) {
+        BatchedAccess& a = batch[i];
+
+        Value* idx[] = {zero, ConstantInt::get(lineTy, i)};
+        GetElementPtrInst* slot = GetElementPtrInst::CreateInBounds(buffer, idx);
+        slot->insertAfter(pos);
+        StoreInst* st = new StoreInst(a.mem, slot);
+        st->insertAfter(slot);
+        pos = st;
+
+        uint64_t siteid = ((ConstantInt*) a.site)->getZExtValue();
+        sites.push_back(ConstantInt::get(Type::getInt32Ty(context), (siteid << 1) | a.write));
+        lines.push_back((Constant*) a.line);
+    }
+
+    Value* first[] = {zero, zero};
+    GetElementPtrInst* mems = GetElementPtrInst::CreateInBounds(buffer, first);
+    mems->insertAfter(pos);
+
+    Constant* idx[] = {zero, zero};
+    ArrayType* sitesTy = ArrayType::get(Type::getInt32Ty(context), sites.size());
+    GlobalVariable* sitesGV = new GlobalVariable(*module, sitesTy, true, GlobalValue::PrivateLinkage,
+            ConstantArray::get(sitesTy, sites), "__trace_batch_sites");
+    sitesGV->setUnnamedAddr(true);
+    ArrayType* linesTy = ArrayType::get(lineTy, lines.size());
+    GlobalVariable* linesGV = new GlobalVariable(*module, linesTy, true, GlobalValue::PrivateLinkage,
+            ConstantArray::get(linesTy, lines), "__trace_batch_lines");
+    linesGV->setUnnamedAddr(true);
+
+    vector<Value*> args;
+    args.push_back(mems);
+    args.push_back(ConstantExpr::getGetElementPtr(sitesGV, idx, true));
+    args.push_back(ConstantExpr::getGetElementPtr(linesGV, idx, true));
+    args.push_back(ConstantInt::get(Type::getInt32Ty(context), batch.size()));
+    args.push_back(file);
+    CallInst::Create(F_accesses, args)->insertAfter(mems);
+
+    batch_num++;
+    batch.clear();
+}
+
+int Transformer4Trace::computeValueIndex(Value* v) {
     v = v->stripPointerCastsNoFollowAliases();
     while(isa<GlobalAlias>(v)){
         // aliase can be either global or bitcast of global
@@ -379,6 +841,10 @@ Value* Transformer4Trace::getOrInsertSrcFileNameValue(Module* module, Instructio
     return ConstantExpr::getGetElementPtr(global_srcfile, indices, true);
 }
 
+Value* Transformer4Trace::getNewSiteValue(Module* module) {
+    return ConstantInt::get(Type::getInt32Ty(module->getContext()), site_num++);
+}
+
 Value* Transformer4Trace::getOtInsertLineNumberValue(Module* module, Instruction * inst){
     MDNode* md = inst->getMetadata("dbg");
     DILocation DI(md);
@@ -394,8 +860,11 @@ bool Transformer4Trace::runOnModule(Module& M){
         AA.getEscapedPointersTo(&sharedVariables, PThreadCreate);
     }
     
-    this->transform(&M, &AA);
-    
+    this->transform(&M, AA);
+
+    outs() << "# instrumented access sites: " << site_num << "\n";
+    outs() << "# instructions with filtered accesses: " << filtered_insts.size() << "\n";
+    outs() << "# batched access hooks: " << batch_num << "\n";
     outs() << "Please add -ltrace for trace analysis when you compile the transformed bitcode file to an executable file. Please use pecan to predict crugs.\n";
     return true;
 }
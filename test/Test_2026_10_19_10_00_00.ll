@@ -0,0 +1,53 @@
+; --dyckaa-summary-cache=.test/summaries --print-alias-set-info
+; ModuleID = 'test.bc'
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu"
+
+%struct.node = type { i32*, %struct.node* }
+
+@head = global %struct.node* null, align 4
+
+; Function Attrs: nounwind
+define void @link(%struct.node* %n, i32* %a, i32* %b) #0 {
+entry:
+  %val = getelementptr inbounds %struct.node* %n, i32 0, i32 0
+  store i32* %a, i32** %val, align 4
+  store i32* %b, i32** %val, align 4
+  %0 = load %struct.node** @head, align 4
+  %next = getelementptr inbounds %struct.node* %n, i32 0, i32 1
+  store %struct.node* %0, %struct.node** %next, align 4
+  store %struct.node* %n, %struct.node** @head, align 4
+  ret void
+}
+
+; Function Attrs: nounwind
+define i32* @first() #0 {
+entry:
+  %0 = load %struct.node** @head, align 4
+  %next = getelementptr inbounds %struct.node* %0, i32 0, i32 1
+  %1 = load %struct.node** %next, align 4
+  %val = getelementptr inbounds %struct.node* %1, i32 0, i32 0
+  %2 = load i32** %val, align 4
+  ret i32* %2
+}
+
+; Function Attrs: nounwind
+define i32 @main() #0 {
+entry:
+  %x = alloca i32, align 4
+  %y = alloca i32, align 4
+  %z = alloca i32, align 4
+  %n1 = alloca %struct.node, align 4
+  %n2 = alloca %struct.node, align 4
+  call void @link(%struct.node* %n1, i32* %x, i32* %y)
+  call void @link(%struct.node* %n2, i32* %z, i32* %z)
+  %call = call i32* @first()
+  store i32 1, i32* %call, align 4
+  ret i32 0
+}
+
+attributes #0 = { nounwind "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-nans-fp-math"="false" "stack-protector-buffer-size"="8" "unsafe-fp-math"="false" "use-soft-float"="false" }
+
+!llvm.ident = !{!0}
+
+!0 = metadata !{metadata !"clang version 3.6.0 (https://github.com/llvm-mirror/clang.git dd525c2374900ac14f64e487d04a208fe1724f21) (https://github.com/llvm-mirror/llvm.git 84230f9a53e8f7a9c9f2144bafad4830aba7686a)"}
@@ -0,0 +1,24 @@
+; --print-alias-set-info --dyckaa-lib-spec=spec/valid.spec
+; ModuleID = 'test.bc'
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu"
+
+; Function Attrs: nounwind
+define i32 @main() #0 {
+entry:
+  %a = alloca i8, align 1
+  %b = alloca i8, align 1
+  %call = call i8* @pick(i8* %a, i8* %b) #1
+  store i8 1, i8* %call, align 1
+  ret i32 0
+}
+
+; Function Attrs: nounwind
+declare i8* @pick(i8*, i8*) #0
+
+attributes #0 = { nounwind "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-nans-fp-math"="false" "stack-protector-buffer-size"="8" "unsafe-fp-math"="false" "use-soft-float"="false" }
+attributes #1 = { nounwind }
+
+!llvm.ident = !{!0}
+
+!0 = metadata !{metadata !"clang version 3.6.0 (https://github.com/llvm-mirror/clang.git 5b0b279f796ecf91b10ba8b0ca89f9dbf802bae4) (https://github.com/llvm-mirror/llvm.git 75318bcc3c15319fce936c3d45b440925998455c)"}
@@ -0,0 +1,60 @@
+; --preserve-dyck-callgraph --trace-transformer --trace-batch=1
+; ModuleID = 'test.bc'
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu"
+
+%union.pthread_attr_t = type { i32, [32 x i8] }
+
+@shared = global i32 0, align 4
+
+; Function Attrs: nounwind
+define i8* @t(i8* %args) #0 {
+entry:
+  %0 = load i32* @shared, align 4
+  %inc = add nsw i32 %0, 1
+  store i32 %inc, i32* @shared, align 4
+  ret i8* null
+}
+
+; the early exit does not join t, so shared++ there races with t; only the
+; stores before the fork and after the join are filtered out
+; Function Attrs: nounwind
+define i32 @main() #0 {
+entry:
+  %tid = alloca i32, align 4
+  store i32 1, i32* @shared, align 4
+  br label %fork
+
+fork:
+  %call = call i32 @pthread_create(i32* %tid, %union.pthread_attr_t* null, i8* (i8*)* @t, i8* null) #1
+  %err = icmp ne i32 %call, 0
+  br i1 %err, label %fail, label %join
+
+fail:
+  %0 = load i32* @shared, align 4
+  %inc = add nsw i32 %0, 1
+  store i32 %inc, i32* @shared, align 4
+  ret i32 1
+
+join:
+  %1 = load i32* %tid, align 4
+  %call1 = call i32 @pthread_join(i32 %1, i8** null) #1
+  br label %done
+
+done:
+  store i32 3, i32* @shared, align 4
+  ret i32 0
+}
+
+; Function Attrs: nounwind
+declare i32 @pthread_create(i32*, %union.pthread_attr_t*, i8* (i8*)*, i8*) #0
+
+; Function Attrs: nounwind
+declare i32 @pthread_join(i32, i8**) #0
+
+attributes #0 = { nounwind "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-nans-fp-math"="false" "stack-protector-buffer-size"="8" "unsafe-fp-math"="false" "use-soft-float"="false" }
+attributes #1 = { nounwind }
+
+!llvm.ident = !{!0}
+
+!0 = metadata !{metadata !"clang version 3.6.0 (https://github.com/llvm-mirror/clang.git 5b0b279f796ecf91b10ba8b0ca89f9dbf802bae4) (https://github.com/llvm-mirror/llvm.git 75318bcc3c15319fce936c3d45b440925998455c)"}
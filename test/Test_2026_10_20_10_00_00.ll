@@ -0,0 +1,42 @@
+; -dyckaa -dyckaa-demand-driven -aa-eval -print-all-alias-modref-info
+; ModuleID = 'test.bc'
+target datalayout = "e-m:e-p:32:32-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i386-pc-linux-gnu"
+
+@G = global i32* null, align 4
+
+; Function Attrs: nounwind
+define void @setG(i32* %p) #0 {
+entry:
+  store i32* %p, i32** @G, align 4
+  ret void
+}
+
+; Function Attrs: nounwind
+define void @r(i32* %x) #0 {
+entry:
+  %g = load i32** @G, align 4
+  store i32 1, i32* %g, align 4
+  store i32 2, i32* %x, align 4
+  ret void
+}
+
+; Function Attrs: nounwind
+define i32 @main() #0 {
+entry:
+  %call = call noalias i8* @malloc(i32 4) #1
+  %o = bitcast i8* %call to i32*
+  call void @setG(i32* %o)
+  call void @r(i32* %o)
+  ret i32 0
+}
+
+; Function Attrs: nounwind
+declare noalias i8* @malloc(i32) #0
+
+attributes #0 = { nounwind "less-precise-fpmad"="false" "no-frame-pointer-elim"="true" "no-frame-pointer-elim-non-leaf" "no-infs-fp-math"="false" "no-nans-fp-math"="false" "stack-protector-buffer-size"="8" "unsafe-fp-math"="false" "use-soft-float"="false" }
+attributes #1 = { nounwind }
+
+!llvm.ident = !{!0}
+
+!0 = metadata !{metadata !"clang version 3.6.0 (https://github.com/llvm-mirror/clang.git 5b0b279f796ecf91b10ba8b0ca89f9dbf802bae4) (https://github.com/llvm-mirror/llvm.git 75318bcc3c15319fce936c3d45b440925998455c)"}
@@ -0,0 +1 @@
+my_alloc -1 alloc
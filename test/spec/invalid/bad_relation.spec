@@ -0,0 +1 @@
+my_alloc * allocate
@@ -0,0 +1 @@
+my_copy 3 content(1 2)
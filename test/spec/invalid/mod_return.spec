@@ -0,0 +1 @@
+my_free 1 mod(r)
@@ -0,0 +1 @@
+my_read 2 ref(3)
@@ -0,0 +1 @@
+my_copy 2 content(1,3)
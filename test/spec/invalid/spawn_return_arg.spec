@@ -0,0 +1 @@
+my_spawn 4 spawn(3,r)
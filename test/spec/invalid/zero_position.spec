@@ -0,0 +1,3 @@
+# the wrong line is not the first one
+my_alloc * alloc
+my_copy 3 alias(0,1)
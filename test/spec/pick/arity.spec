@@ -0,0 +1,2 @@
+# pick is called with two arguments, so this line is not used
+pick 3 alias(r,1) alias(1,2)
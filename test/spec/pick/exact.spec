@@ -0,0 +1 @@
+pick 2 alias(r,1)
@@ -0,0 +1,3 @@
+# a later line of the same arity replaces the earlier one
+pick 2 alias(r,1) alias(1,2)
+pick 2 alias(r,1)
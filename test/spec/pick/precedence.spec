@@ -0,0 +1,3 @@
+# the line of the exact number of arguments goes before *
+pick * alias(r,1) alias(1,2)
+pick 2 alias(r,1)
@@ -0,0 +1 @@
+pick * alias(r,1)
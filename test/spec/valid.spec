@@ -0,0 +1,14 @@
+# every line must be accepted by -dyckaa-lib-spec
+
+my_alloc        *  alloc nomem       # any number of arguments
+my_alloc        2  alloc mod(2)      # the exact number goes first
+my_dup          1  alloc content(1,r) ref(1)
+my_copy         3  content(1,2) alias(r,1) mod(1) ref(2)
+my_copy         3  content(1,2) mod(1) ref(2)   # replaces the line above
+my_get          2  keyvalue(1,r) ref(1)
+my_set          3  keyvalue(1,3) mod(1)
+my_spawn        4  spawn(3,4)
+my_pool_submit  *  spawn(2,3)
+my_touch        *  mod(5) ref(7)     # no arity to check with *
+my_pure         0  nomem
+strchr          2  alias(r,1) ref(1) # replaces the built-in line
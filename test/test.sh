@@ -24,6 +24,166 @@ do
     fi
 done
 
+# hand-written summaries of two modules: a pointer call in a.c is resolved
+# to a function stored into a shared global in b.c
+num=$((num+1))
+mkdir -p .test
+echo "Test: dyckmerge dyckmerge/*.dsum"
+echo "==============================================="
+dyckmerge -o .test/dyckmerge.out dyckmerge/*.dsum
+exitcode=$?
+if [ $exitcode != 0 ] || ! diff dyckmerge/expected.out .test/dyckmerge.out; then
+    echo "==============================================="
+    echo "Test Fail! Exit code: $exitcode, or the result differs from dyckmerge/expected.out."
+    exit -1;
+fi
+
+# the same module is analyzed twice with -dyckaa-summary-cache, the second
+# time from the summaries saved the first time, and the alias sets must be
+# the same; distribution.log is sorted, since it is in the order of addresses
+num=$((num+1))
+file=Test_2026_10_19_10_00_00.ll
+option=`head -1 $file`
+option=${option:1}
+rm -rf .test/summaries
+llvm-as $file -o .test/summary.bc
+for run in 1 2
+do
+    echo "Test: canary $option .test/summary.bc (run $run)"
+    echo "==============================================="
+    canary $option .test/summary.bc -o .test/summary$run.bc > .test/summary$run.out
+    exitcode=$?
+    if [ $exitcode != 0 ]; then
+        echo "==============================================="
+        echo "Test Fail! Exit code: $exitcode."
+        exit -1;
+    fi
+    grep "Alias Queries\|no alias responses" .test/summary$run.out > .test/summary$run.aa
+    sort -n distribution.log >> .test/summary$run.aa
+done
+rm -f distribution.log alias_rel.dot
+if ! grep -q "# Summaries: [1-9][0-9]* reused" .test/summary2.out || ! diff .test/summary1.aa .test/summary2.aa; then
+    echo "==============================================="
+    echo "Test Fail! The summaries are not reused, or the alias sets differ."
+    exit -1;
+fi
+
+# the lines of the specs in spec/invalid must be rejected by -dyckaa-lib-spec,
+# and the specs in spec/pick must give pick(a, b) the same relation, except
+# arity.spec, whose line is for three arguments
+num=$((num+1))
+llvm-as Test_2026_10_19_11_00_00.ll -o .test/spec.bc
+for spec in spec/invalid/*.spec
+do
+    echo "Test: canary --dyckaa-lib-spec=$spec .test/spec.bc (must be rejected)"
+    echo "==============================================="
+    canary --dyckaa-lib-spec=$spec .test/spec.bc -o .test/spec.out.bc
+    if [ $? == 0 ]; then
+        echo "==============================================="
+        echo "Test Fail! $spec is accepted."
+        exit -1;
+    fi
+done
+for spec in spec/pick/*.spec
+do
+    name=`basename $spec .spec`
+    echo "Test: canary --print-alias-set-info --dyckaa-lib-spec=$spec .test/spec.bc"
+    echo "==============================================="
+    canary --print-alias-set-info --dyckaa-lib-spec=$spec .test/spec.bc -o .test/spec.out.bc > .test/$name.out
+    exitcode=$?
+    if [ $exitcode != 0 ]; then
+        echo "==============================================="
+        echo "Test Fail! Exit code: $exitcode."
+        exit -1;
+    fi
+    grep "Alias Queries\|no alias responses" .test/$name.out > .test/$name.aa
+    sort -n distribution.log >> .test/$name.aa
+done
+rm -f distribution.log alias_rel.dot
+for name in star override precedence
+do
+    if ! diff .test/exact.aa .test/$name.aa; then
+        echo "==============================================="
+        echo "Test Fail! The alias sets of spec/pick/$name.spec differ from those of exact.spec."
+        exit -1;
+    fi
+done
+if diff .test/exact.aa .test/arity.aa > /dev/null; then
+    echo "==============================================="
+    echo "Test Fail! The line of spec/pick/arity.spec is used for a call of two arguments."
+    exit -1;
+fi
+
+# the built-in spec models pthread_create as before it was a spec, i.e. it
+# calls its third argument, so the call graph has pthread_create -> t
+num=$((num+1))
+llvm-as Test_2014_11_16_01_01_00.ll -o .test/spawn.bc
+echo "Test: canary --dot-dyck-callgraph .test/spawn.bc"
+echo "==============================================="
+canary --dot-dyck-callgraph .test/spawn.bc -o .test/spawn.out.bc
+exitcode=$?
+dot=.test/spawn.bc.maycg.dot
+create=`sed -n 's/.*f\([0-9]*\)\[label="pthread_create"\].*/\1/p' $dot`
+thread=`sed -n 's/.*f\([0-9]*\)\[label="t"\].*/\1/p' $dot`
+if [ $exitcode != 0 ] || [ -z "$create" ] || [ -z "$thread" ] || ! grep -q "f$create->f$thread\$" $dot; then
+    echo "==============================================="
+    echo "Test Fail! Exit code: $exitcode, or pthread_create does not call t in $dot."
+    exit -1;
+fi
+
+# the trace transformer only filters out the accesses after a fork that are
+# after the joins of all the forked threads; each check is a test, a block of
+# its main, and the number of stores instrumented in the block
+num=$((num+1))
+for check in "Test_2026_10_20_09_00_00 fail 1" "Test_2026_10_20_09_00_00 done 0" "Test_2026_10_20_09_10_00 done 1"
+do
+    set -- $check
+    option=`head -1 $1.ll`
+    option=${option:1}
+    llvm-as $1.ll -o .test/$1.trace.bc
+    echo "Test: canary $option .test/$1.trace.bc (block $2)"
+    echo "==============================================="
+    canary $option .test/$1.trace.bc -o .test/$1.trace.out.bc
+    exitcode=$?
+    llvm-dis .test/$1.trace.out.bc -o .test/$1.trace.ll
+    stores=`awk "/^$2:/{p=1} p&&/^\$/{p=0} p" .test/$1.trace.ll | grep -c "call void @OnStore("`
+    if [ $exitcode != 0 ] || [ "$stores" != $3 ]; then
+        echo "==============================================="
+        echo "Test Fail! Exit code: $exitcode, or $stores instead of $3 stores are instrumented in $2 of $1.ll."
+        exit -1;
+    fi
+done
+
+# in r, x and the pointer loaded from G alias only through the calls of main,
+# whose arguments reach them; the demand-driven mode must give the same alias
+# results as the default one
+num=$((num+1))
+file=Test_2026_10_20_10_00_00.ll
+option=`head -1 $file`
+option=${option:1}
+llvm-as $file -o .test/demand.bc
+for mode in "demand" "default"
+do
+    if [ $mode == "default" ]; then
+        option=${option/-dyckaa-demand-driven /}
+    fi
+    echo "Test: canary $option .test/demand.bc ($mode)"
+    echo "==============================================="
+    canary $option .test/demand.bc -o .test/demand.out.bc 2> .test/$mode.err
+    exitcode=$?
+    if [ $exitcode != 0 ]; then
+        echo "==============================================="
+        echo "Test Fail! Exit code: $exitcode."
+        exit -1;
+    fi
+    grep "Alias:" .test/$mode.err > .test/$mode.aa
+done
+if ! grep -q "MayAlias:.*%g.*%x\|MayAlias:.*%x.*%g" .test/demand.aa || ! diff .test/default.aa .test/demand.aa; then
+    echo "==============================================="
+    echo "Test Fail! x and the pointer loaded from G are not aliased, or the alias results differ."
+    exit -1;
+fi
+
 rm -rf .test/
 
 echo "==============================================="
@@ -64,6 +64,7 @@
 #include "DyckAA/DyckAliasAnalysis.h"
 #include "Transformer/Transformer4Trace.h"
 #include "Transformer/Transformer4Leap.h"
+#include "Devirt/SpeculativeDevirt.h"
 
 using namespace llvm;
 using namespace opt_tool;
@@ -75,6 +76,9 @@ TraceTrans("trace-transformer", cl::desc("Transform programs to record a trace."
 static cl::opt<bool>
 LeapTrans("leap-transformer", cl::desc("Transform programs using Leap transformer."));
 
+static cl::opt<bool>
+SpeculativeDevirtualize("speculative-devirt", cl::desc("Rewrite resolved pointer calls into direct calls before the optimizations."));
+
 // The OptimizationList is automatically populated with registered Passes by the
 // PassNameParser.
 //
@@ -482,6 +486,16 @@ int main(int argc, char **argv) {
   if (StripDebug)
     addPass(Passes, createStripSymbolsPass(true));
 
+  // Devirtualize before the optimizations, so that the direct calls can be
+  // inlined
+  if (SpeculativeDevirtualize) {
+    Passes.add(createLowerInvokePass());
+    Passes.add(createCFGSimplificationPass());
+    Passes.add(createBasicAliasAnalysisPass());
+    Passes.add(createDyckAliasAnalysisPass());
+    Passes.add(createSpeculativeDevirtPass());
+  }
+
   // Create a new optimization pass for each one specified on the command line
   for (unsigned i = 0; i < PassList.size(); ++i) {
     if (StandardLinkOpts &&
@@ -0,0 +1,345 @@
+/*
+ * Merge the summaries of modules, which are saved by
+ * canary -dyckaa-export-summary, and compute the fixpoint of unification
+ * and indirect calls over the whole program.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "DyckAA/EdgeLabel.h"
+#include "DyckAA/ModuleSummary.h"
+#include "DyckGraph/DyckGraph.h"
+
+using namespace std;
+
+/* ************************************************************************
+ * The merged graph
+ * ************************************************************************/
+
+vector<ModuleSummary*> summaries;
+
+DyckGraph graph;
+
+/// Vertex i of module m is created with the value &keys[bases[m] + i], so
+/// that its representative can be found after it is combined.
+vector<char> keys;
+vector<unsigned> bases;
+
+DerefEdgeLabel derefLabel;
+map<long, EdgeLabel*> offsetLabels;
+map<long, EdgeLabel*> indexLabels;
+
+/// the first definition of each function
+map<string, pair<unsigned, ModuleSummary::FunctionInfo*> > definitions;
+
+unsigned long directNum = 0;
+unsigned long indirectNum = 0;
+
+DyckVertex* rep(unsigned m, unsigned v) {
+    return graph.findDyckVertex(&keys[bases[m] + v]);
+}
+
+void* label(char kind, long num) {
+    if (kind == 'd') {
+        return &derefLabel;
+    }
+
+    map<long, EdgeLabel*>& labels = kind == 'o' ? offsetLabels : indexLabels;
+    auto it = labels.find(num);
+    if (it != labels.end()) {
+        return it->second;
+    }
+
+    EdgeLabel* l;
+    if (kind == 'o') {
+        l = new PointerOffsetEdgeLabel(num);
+    } else {
+        l = new FieldIndexEdgeLabel(num);
+    }
+    labels[num] = l;
+    return l;
+}
+
+void combine(unsigned m1, unsigned v1, unsigned m2, unsigned v2) {
+    if (v1 == ModuleSummary::NONE || v2 == ModuleSummary::NONE) {
+        return;
+    }
+    DyckVertex* x = rep(m1, v1);
+    DyckVertex* y = rep(m2, v2);
+    if (x != y) {
+        graph.combine(x, y);
+    }
+}
+
+/// The same as matching the arguments and the parameters, and the return
+/// values in AAAnalyzer::handle_common_function_call.
+void link(unsigned m, ModuleSummary::CallInfo& c, unsigned fm, ModuleSummary::FunctionInfo& f) {
+    if (c.ret != ModuleSummary::NONE) {
+        for (auto r : f.rets) {
+            combine(m, c.ret, fm, r);
+        }
+    }
+
+    for (unsigned i = 0; i < c.args.size(); i++) {
+        if (i < f.params.size()) {
+            combine(m, c.args[i], fm, f.params[i]);
+        } else if (f.varArg) {
+            for (auto va : f.vaargs) {
+                combine(m, c.args[i], fm, va);
+            }
+        }
+    }
+}
+
+/// Function types are not in the summaries, so only the numbers of the
+/// parameters are checked.
+bool isCompatible(ModuleSummary::CallInfo& c, ModuleSummary::FunctionInfo& f) {
+    return c.args.size() == f.params.size() || (f.varArg && c.args.size() >= f.params.size());
+}
+
+void build() {
+    unsigned total = 0;
+    for (auto s : summaries) {
+        bases.push_back(total);
+        total += s->vertexNum;
+    }
+    keys.resize(total + 1);
+
+    map<string, pair<unsigned, unsigned> > symbols;
+    auto addSymbol = [&](const string& name, unsigned m, unsigned v) {
+        if (v == ModuleSummary::NONE) {
+            return;
+        }
+        auto it = symbols.find(name);
+        if (it == symbols.end()) {
+            symbols[name] = make_pair(m, v);
+        } else {
+            combine(it->second.first, it->second.second, m, v);
+        }
+    };
+
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        ModuleSummary* s = summaries[m];
+        for (unsigned v = 0; v < s->vertexNum; v++) {
+            graph.retrieveDyckVertex(&keys[bases[m] + v]);
+        }
+        for (auto& e : s->edges) {
+            DyckVertex* from = rep(m, e.from);
+            DyckVertex* to = rep(m, e.to);
+            void* l = label(e.kind, e.num);
+            if (!from->containsTarget(to, l)) {
+                from->addTarget(to, l);
+            }
+        }
+    }
+
+    // the same symbols in different modules
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        ModuleSummary* s = summaries[m];
+        for (auto& g : s->globals) {
+            addSymbol(g.first, m, g.second);
+        }
+        for (auto& f : s->functions) {
+            addSymbol(f.name, m, f.vertex);
+            if (!f.defined) {
+                continue;
+            }
+
+            auto it = definitions.find(f.name);
+            if (it == definitions.end()) {
+                definitions[f.name] = make_pair(m, &f);
+            } else {
+                // e.g. linkonce functions, which are merged into one
+                ModuleSummary::FunctionInfo* def = it->second.second;
+                for (unsigned i = 0; i < f.params.size() && i < def->params.size(); i++) {
+                    combine(m, f.params[i], it->second.first, def->params[i]);
+                }
+                for (auto r : f.rets) {
+                    for (auto dr : def->rets) {
+                        combine(m, r, it->second.first, dr);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void fixpoint() {
+    // resolved callees of each call, including those resolved in the modules
+    vector<vector<set<string> > > resolved(summaries.size());
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        for (auto& c : summaries[m]->calls) {
+            resolved[m].push_back(set<string>(c.callees.begin(), c.callees.end()));
+        }
+    }
+
+    unsigned iteration = 0;
+    bool finished = false;
+    while (!finished) {
+        finished = true;
+        printf("Iteration #%u...\n", ++iteration);
+        graph.qirunAlgorithm();
+
+        // the functions whose addresses are taken, bucketed by representatives
+        map<DyckVertex*, vector<string> > buckets;
+        for (unsigned m = 0; m < summaries.size(); m++) {
+            for (auto& f : summaries[m]->functions) {
+                if (f.vertex != ModuleSummary::NONE) {
+                    buckets[rep(m, f.vertex)].push_back(f.name);
+                }
+            }
+        }
+
+        for (unsigned m = 0; m < summaries.size(); m++) {
+            vector<ModuleSummary::CallInfo>& calls = summaries[m]->calls;
+            for (unsigned i = 0; i < calls.size(); i++) {
+                ModuleSummary::CallInfo& c = calls[i];
+                vector<string> candidates;
+                if (!c.callee.empty()) {
+                    candidates.push_back(c.callee);
+                } else {
+                    auto bit = buckets.find(rep(m, c.calledValue));
+                    if (bit != buckets.end()) {
+                        candidates = bit->second;
+                    }
+                }
+
+                for (auto& name : candidates) {
+                    auto dit = definitions.find(name);
+                    if (dit == definitions.end() || resolved[m][i].count(name)) {
+                        continue;
+                    }
+
+                    ModuleSummary::FunctionInfo& f = *(dit->second.second);
+                    if (!c.callee.empty() || isCompatible(c, f)) {
+                        resolved[m][i].insert(name);
+                        link(m, c, dit->second.first, f);
+                        finished = false;
+                        if (c.callee.empty()) {
+                            indirectNum++;
+                        } else {
+                            directNum++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        vector<ModuleSummary::CallInfo>& calls = summaries[m]->calls;
+        for (unsigned i = 0; i < calls.size(); i++) {
+            calls[i].callees.assign(resolved[m][i].begin(), resolved[m][i].end());
+        }
+    }
+}
+
+/// Print the callees of the pointer calls, and the global symbols that may
+/// be aliases of each other.
+bool print(const char* file) {
+    FILE* fp = fopen(file, "w");
+    if (!fp) {
+        return false;
+    }
+
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        ModuleSummary* s = summaries[m];
+        for (unsigned i = 0; i < s->calls.size(); i++) {
+            ModuleSummary::CallInfo& c = s->calls[i];
+            if (!c.callee.empty()) {
+                continue;
+            }
+            fprintf(fp, "call %s %s #%u:", s->module.c_str(), c.caller.c_str(), i);
+            for (auto& callee : c.callees) {
+                fprintf(fp, " %s", callee.c_str());
+            }
+            fprintf(fp, "\n");
+        }
+    }
+
+    map<DyckVertex*, set<string> > aliases;
+    for (unsigned m = 0; m < summaries.size(); m++) {
+        for (auto& g : summaries[m]->globals) {
+            if (g.second != ModuleSummary::NONE) {
+                aliases[rep(m, g.second)].insert(g.first);
+            }
+        }
+    }
+    for (auto& a : aliases) {
+        if (a.second.size() > 1) {
+            fprintf(fp, "alias");
+            for (auto& name : a.second) {
+                fprintf(fp, " %s", name.c_str());
+            }
+            fprintf(fp, "\n");
+        }
+    }
+
+    bool ok = !ferror(fp);
+    return fclose(fp) == 0 && ok;
+}
+
+void usage() {
+    printf("Usage: dyckmerge [-o <result_file>] <summary_file>...\n");
+    printf("  -o <file>  the callees of pointer calls and the aliased global symbols (dyckmerge.out)\n");
+}
+
+int main(int argc, char * argv[]) {
+    const char* output = "dyckmerge.out";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+            case 'o': output = optarg;
+                break;
+            default:
+                usage();
+                exit(-1);
+        }
+    }
+
+    if (optind >= argc) {
+        usage();
+        exit(-1);
+    }
+
+    unsigned long vertexNum = 0, callNum = 0;
+    for (int i = optind; i < argc; i++) {
+        ModuleSummary* s = new ModuleSummary;
+        if (!s->load(argv[i])) {
+            fprintf(stderr, "ERROR: %s is not a valid module summary.\n", argv[i]);
+            exit(-1);
+        }
+        vertexNum += s->vertexNum;
+        callNum += s->calls.size();
+        summaries.push_back(s);
+    }
+    printf("# Modules: %lu\n", (unsigned long) summaries.size());
+    printf("# Vertices: %lu\n", vertexNum);
+    printf("# Calls: %lu\n", callNum);
+
+    build();
+    fixpoint();
+
+    printf("# Alias sets: %u\n", graph.numEquivalentClasses());
+    printf("# Resolved calls: %lu direct, %lu indirect\n", directNum, indirectNum);
+
+    if (!print(output)) {
+        fprintf(stderr, "ERROR: cannot write %s.\n", output);
+        exit(-1);
+    }
+
+    for (auto s : summaries) {
+        delete s;
+    }
+    return 0;
+}
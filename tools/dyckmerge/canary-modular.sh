@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Analyze a program module by module. Each bitcode file (e.g. one per source
+# file) is analyzed by a separate canary process, at most <jobs> of them at
+# the same time, and then their summaries are merged by dyckmerge.
+#
+# Usage: canary-modular.sh [-j <jobs>] [-d <summary_dir>] [-o <result_file>] <bitcode_file>...
+#   e.g. canary-modular.sh -j 8 -o result.txt `find . -name "*.bc"`
+
+jobs=`nproc 2>/dev/null || echo 1`
+dir=""
+result=dyckmerge.out
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -j) jobs=$2; shift 2;;
+        -d) dir=$2; shift 2;;
+        -o) result=$2; shift 2;;
+        --) shift; break;;
+        *) break;;
+    esac
+done
+
+if [ $# -eq 0 ]; then
+    echo "Usage: canary-modular.sh [-j <jobs>] [-d <summary_dir>] [-o <result_file>] <bitcode_file>..."
+    exit -1
+fi
+
+for tool in canary dyckmerge; do
+    if ! which $tool > /dev/null 2>&1; then
+        echo "Error: $tool does not exist! Termination."
+        exit -1
+    fi
+done
+
+if [ "$dir" = "" ]; then
+    dir=`mktemp -d`
+else
+    mkdir -p $dir || exit -1
+fi
+
+# phase one: one summary per bitcode file, named by its position
+i=0
+for bc in "$@"; do
+    echo "$i $bc"
+    i=$((i + 1))
+done | xargs -P $jobs -L 1 sh -c \
+    'canary -dyckaa-export-summary='$dir'/$0.dsum "$1" -o /dev/null > '$dir'/$0.log 2>&1 || { echo "canary fails on $1, see '$dir'/$0.log"; exit 255; }' \
+    || exit -1
+
+# phase two: merge them
+summaries=""
+i=0
+for bc in "$@"; do
+    summaries="$summaries $dir/$i.dsum"
+    i=$((i + 1))
+done
+dyckmerge -o $result $summaries
@@ -55,12 +55,18 @@ public:
         }
     }
 
-    bool is_reachable(int from, int to) {
-
+    /// Compute the transitive closure in advance. After that, is_reachable
+    /// only reads the closure and can be called from multiple threads as
+    /// long as no edge is inserted.
+    void close() {
         if (TC == NULL) {
             TC = new boostgraph;
             transitive_closure(*hbg, *TC);
         }
+    }
+
+    bool is_reachable(int from, int to) {
+        close();
 
         // test reachability
         return boost::edge(from, to, *TC).second;
@@ -0,0 +1,110 @@
+/*
+ * File:   Lockset.h
+ *
+ * Interned locksets. Every distinct set of held locks gets an id, and events
+ * only store the id of the lockset held when they happen. Id 0 is always
+ * the empty lockset.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef LOCKSET_HPP
+#define	LOCKSET_HPP
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+#define EMPTY_LOCKSET 0
+#define LOCKSET_CACHE_SIZE 4096
+
+class LocksetTable {
+private:
+    vector<vector<int> > locksets; // id -> sorted locks
+    map<vector<int>, int> ids; // sorted locks -> id
+
+    /// A direct-mapped cache of intersection results. An entry packs
+    /// (a + 1, b, result) into 64 bits, and 0 means the entry is empty.
+    /// Entries are read and written atomically, so that pecan's workers
+    /// can share the cache without locks.
+    uint64_t cache[LOCKSET_CACHE_SIZE];
+
+public:
+
+    LocksetTable() {
+        vector<int> empty;
+        locksets.push_back(empty);
+        ids.insert(pair<vector<int>, int>(empty, EMPTY_LOCKSET));
+
+        for (unsigned i = 0; i < LOCKSET_CACHE_SIZE; i++) {
+            cache[i] = 0;
+        }
+    }
+
+    /// Get the id of the lockset, a new id is assigned if it has not been seen.
+    /// It is not thread-safe and should be used before the prediction.
+    int intern(const set<int>& locks) {
+        vector<int> sorted(locks.begin(), locks.end());
+
+        map<vector<int>, int>::iterator it = ids.find(sorted);
+        if (it != ids.end()) {
+            return it->second;
+        }
+
+        int id = locksets.size();
+        locksets.push_back(sorted);
+        ids.insert(pair<vector<int>, int>(sorted, id));
+        return id;
+    }
+
+    const vector<int>& get(int id) {
+        return locksets[id];
+    }
+
+    unsigned size() {
+        return locksets.size();
+    }
+
+    /// Whether the two locksets share at least one lock.
+    bool intersects(int a, int b) {
+        if (a == EMPTY_LOCKSET || b == EMPTY_LOCKSET) return false;
+        if (a == b) return true;
+
+        if (a > b) {
+            int temp = a;
+            a = b;
+            b = temp;
+        }
+
+        uint64_t key = ((((uint64_t) a + 1) << 32) | (uint64_t) (uint32_t) b) << 1;
+        uint64_t& slot = cache[((unsigned) a * 31 + (unsigned) b) % LOCKSET_CACHE_SIZE];
+
+        uint64_t entry = __atomic_load_n(&slot, __ATOMIC_RELAXED);
+        if ((entry & ~((uint64_t) 1)) == key) {
+            return entry & 1;
+        }
+
+        bool ret = intersects(locksets[a], locksets[b]);
+        __atomic_store_n(&slot, key | (ret ? 1 : 0), __ATOMIC_RELAXED);
+        return ret;
+    }
+
+private:
+
+    /// Both vectors are sorted, so a linear merge is enough.
+    static bool intersects(const vector<int>& x, const vector<int>& y) {
+        unsigned i = 0, j = 0;
+        while (i < x.size() && j < y.size()) {
+            if (x[i] == y[j]) return true;
+            if (x[i] < y[j]) i++;
+            else j++;
+        }
+        return false;
+    }
+};
+
+#endif	/* LOCKSET_HPP */
@@ -9,6 +9,9 @@
 #include <signal.h>
 #include <unistd.h>
 #include <assert.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <map>
 #include <vector>
 #include <set>
@@ -16,6 +19,8 @@
 #include "Hbgraph.h"
 #include "TraceSupport/Event.h"
 #include "Anomaly.h"
+#include "ThreadPool.h"
+#include "Lockset.h"
 
 using namespace std;
 
@@ -43,34 +48,28 @@ vector<struct Thread *> threads;
 map<pthread_t, struct Thread *> _map;
 
 HBGraph * hbgraph = NULL;
+LocksetTable locksets;
 
 void init_threads() {
-    map<pthread_t, set<int>* > _locks_map;
+    map<pthread_t, set<int> > _locks_map;
+    map<pthread_t, int> _lockset_map;
     for (int i = 0; i < events_pointer; i++) {
         // init locks for each event
-        set<int>* _locks = NULL;
-        if (!_locks_map.count(events[i].tid)) {
-            _locks = new set<int>;
-            _locks_map.insert(pair<pthread_t, set<int>* >(events[i].tid, _locks));
-        } else {
-            _locks = _locks_map[events[i].tid];
+        set<int>& _locks = _locks_map[events[i].tid];
+        if (!_lockset_map.count(events[i].tid)) {
+            _lockset_map[events[i].tid] = EMPTY_LOCKSET;
         }
 
         if (events[i].type == ACQUIRE) {
-            _locks->insert(events[i].mem);
+            _locks.insert(events[i].mem);
+            _lockset_map[events[i].tid] = locksets.intern(_locks);
         }
 
-        events[i].lock_num = _locks->size();
-        events[i].locks = new int[events[i].lock_num];
-        int index = 0;
-        set<int>::iterator it = _locks->begin();
-        while (it != _locks->end()) {
-            events[i].locks[index++] = *it;
-            it++;
-        }
+        events[i].lockset = _lockset_map[events[i].tid];
 
         if (events[i].type == RELEASE) {
-            _locks->erase(events[i].mem);
+            _locks.erase(events[i].mem);
+            _lockset_map[events[i].tid] = locksets.intern(_locks);
         }
 
         // init threads
@@ -86,13 +85,6 @@ void init_threads() {
         }
     }
 
-    //delete lock_set
-    vector<struct Thread *>::iterator it = threads.begin();
-    while (it != threads.end()) {
-        delete _locks_map[(*it)->tid];
-        it++;
-    }
-
     // init happens-before graph, and determine whether it is a planar graph
     hbgraph = new HBGraph(events_pointer);
 
@@ -102,9 +94,9 @@ void init_threads() {
     vector<int> waits;
 
     // program order
-    it = threads.begin();
+    vector<struct Thread *>::iterator it = threads.begin();
     while (it != threads.end()) {
-        vector<Event *> es = (*it)->events;
+        const vector<Event *>& es = (*it)->events;
         for (unsigned i = 0; i < es.size(); i++) {
             if (i + 1 < es.size())
                 hbgraph->insert_edge(es[i]->eid, es[i + 1]->eid);
@@ -128,12 +120,15 @@ void init_threads() {
         it++;
     }
     // fork join order
+    // a thread may have no events in a sampled trace
     for (unsigned i = 0; i < forks.size(); i++) {
         pthread_t forked_tid = events[forks[i]].synctid;
+        if (!_map.count(forked_tid)) continue;
         hbgraph->insert_edge(events[forks[i]].eid, (_map[forked_tid]->events).front()->eid);
     }
     for (unsigned i = 0; i < joins.size(); i++) {
         pthread_t joined_tid = events[joins[i]].synctid;
+        if (!_map.count(joined_tid)) continue;
         hbgraph->insert_edge((_map[joined_tid]->events).back()->eid, events[joins[i]].eid);
     }
 
@@ -157,6 +152,52 @@ void init_threads() {
     }
 }
 
+/* ************************************************************************
+ * Phases
+ *
+ * The time and the peak memory of each phase are printed, so that pecan
+ * can be benchmarked phase by phase (see tools/tracegen/pecan-bench.sh).
+ * The peak memory is the resident set high water mark, which is reset at
+ * the beginning of each phase if the kernel supports it.
+ * ************************************************************************/
+struct timeval phase_start;
+
+long peakMemory() {
+    FILE* status = fopen("/proc/self/status", "r");
+    if (status) {
+        char line[128];
+        long kb = -1;
+        while (fgets(line, sizeof (line), status)) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kb = atol(line + 6);
+                break;
+            }
+        }
+        fclose(status);
+        if (kb >= 0) return kb;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void beginPhase() {
+    FILE* refs = fopen("/proc/self/clear_refs", "w");
+    if (refs) {
+        fputs("5", refs); // reset the peak resident set size
+        fclose(refs);
+    }
+    gettimeofday(&phase_start, NULL);
+}
+
+void endPhase(const char* name) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double seconds = (now.tv_sec - phase_start.tv_sec) + (now.tv_usec - phase_start.tv_usec) / 1000000.0;
+    printf("[PECAN] Phase %s: %.3f s, peak memory %ld KB.\n", name, seconds, peakMemory());
+}
+
 /* ************************************************************************
  * Main program
  * ************************************************************************/
@@ -176,12 +217,31 @@ void init(const char * filename, const char* outfilename) {
         exit(-1);
     }
 
-    fread(&events_pointer, sizeof (long), 1, fin);
-    printf("[PECAN] Read %ld events from log file.\n", events_pointer);
-    fread(events, sizeof (struct Event), events_pointer, fin);
+    if (fread(&events_pointer, sizeof (long), 1, fin) != 1 || events_pointer < 0) {
+        events_pointer = 0;
+    }
+    if (events_pointer > MAX_EVENT_NUM) {
+        printf("[PECAN] Only the first %d of %ld events are analyzed.\n", MAX_EVENT_NUM, events_pointer);
+        events_pointer = MAX_EVENT_NUM;
+    }
+
+    // the trace may be truncated, e.g. the program is killed
+    long expected = events_pointer;
+    events_pointer = fread(events, sizeof (struct Event), events_pointer, fin);
     fclose(fin);
 
+    printf("[PECAN] Read %ld events from log file.\n", events_pointer);
+    if (events_pointer < expected) {
+        printf("[PECAN] The log file is truncated, %ld events are expected.\n", expected);
+    }
+
+    // eids are indices of events
+    for (long i = 0; i < events_pointer; i++) {
+        events[i].eid = i;
+    }
+
     init_threads();
+    printf("[PECAN] %u distinct locksets.\n", locksets.size());
 }
 
 void dump() {
@@ -195,20 +255,7 @@ void dump() {
 int hasSameLock(struct Event *e1, struct Event *e2) {
     assert(e1->tid != e2->tid);
 
-    int * locks1 = e1->locks;
-    int num1 = e1->lock_num;
-
-    int * locks2 = e2->locks;
-    int num2 = e2->lock_num;
-
-    for (int i = 0; i < num1; i++) {
-        int locki = locks1[i];
-        for (int j = 0; j < num2; j++) {
-            int lockj = locks2[j];
-            if (locki == lockj) return 1;
-        }
-    }
-    return 0;
+    return locksets.intersects(e1->lockset, e2->lockset) ? 1 : 0;
 }
 
 /* ************************************************************************
@@ -312,7 +359,7 @@ void predictDataRaces() {
 
 }
 
-bool canFindOne(int from, int to, vector<struct Event *>& vec, struct Event* ej) {
+bool canFindOne(int from, int to, const vector<struct Event *>& vec, struct Event* ej) {
     for (int q = from; q <= to; q++) {
         struct Event * eq = vec[q];
         if (check(eq, ej)) {
@@ -323,48 +370,77 @@ bool canFindOne(int from, int to, vector<struct Event *>& vec, struct Event* ej)
     return false;
 }
 
-void predictSAVs() {
-    for (unsigned i = 0; i < threads.size(); i++) {
-        struct Thread * thread_i = threads[i];
-        vector<Event *> events_i = thread_i->events;
-        for (unsigned j = 0; j < threads.size(); j++) {
-            if (i == j) continue;
+/* ************************************************************************
+ * Parallel prediction
+ *
+ * Each (thread_i, thread_j) pair is an independent task. Anomalies found
+ * by a task are kept in a task-local vector and merged in task order, so
+ * that the output is identical to a single-threaded run.
+ * ************************************************************************/
+unsigned worker_num = 1;
 
-            struct Thread * thread_j = threads[j];
-            vector<Event *> events_j = thread_j->events;
+struct ThreadPair {
+    unsigned i;
+    unsigned j;
+};
 
-            for (unsigned m = 0; m < events_i.size(); m++) {
-                for (unsigned n = m + 1; n < events_i.size(); n++) {
+struct PredictTasks {
+    vector<ThreadPair> pairs;
+    vector<vector<Anomaly*> > found; // task-local anomalies
+};
 
-                    if (events_i[m]->mem != events_i[n]->mem) continue;
+void merge(PredictTasks& tasks, vector<Anomaly*>& anomalies) {
+    for (unsigned t = 0; t < tasks.found.size(); t++) {
+        vector<Anomaly*>& found = tasks.found[t];
+        for (unsigned k = 0; k < found.size(); k++) {
+            Anomaly* a = found[k];
+            if (a->getEvent(3) != NULL) {
+                fprintf(fout, "[mAtomicity] Line %ld\tLine %ld\t Line %ld\t Line %ld.\n", a->getEvent(0)->line, a->getEvent(1)->line, a->getEvent(2)->line, a->getEvent(3)->line);
+            } else {
+                fprintf(fout, "[sAtomicity] Line %ld\tLine %ld\t Line %ld.\n", a->getEvent(0)->line, a->getEvent(1)->line, a->getEvent(2)->line);
+            }
 
-                    for (unsigned p = 0; p < events_j.size(); p++) {
-                        struct Event * ej = events_j[p];
+            bool existed = false;
+            for (unsigned o = 0; o < anomalies.size(); o++) {
+                if (anomalies[o]->equals(a)) {
+                    existed = true;
+                    break;
+                }
+            }
+            if (!existed) {
+                anomalies.push_back(a);
+            } else {
+                delete a;
+            }
+        }
+        found.clear();
+    }
+}
 
-                        if (events_i[m]->mem != ej->mem) continue;
+void predictSAVsForPair(unsigned task, unsigned worker, void* arg) {
+    PredictTasks* tasks = (PredictTasks*) arg;
+    vector<Anomaly*>& found = tasks->found[task];
 
-                        if (checkSAV(events_i[m], events_j[p], events_i[n])) {
-                            if (canFindOne(m, n, events_i, ej)) {
-                                //printf("[PECAN] [sAtomicity] Line %d\tLine %d\t Line %d.\n", events_i[m]->line, events_j[p]->line, events_i[n]->line);
-                                fprintf(fout, "[sAtomicity] Line %ld\tLine %ld\t Line %ld.\n", events_i[m]->line, events_j[p]->line, events_i[n]->line);
+    const vector<Event *>& events_i = threads[tasks->pairs[task].i]->events;
+    const vector<Event *>& events_j = threads[tasks->pairs[task].j]->events;
 
-                                Anomaly* sav = new Anomaly(S_ATOMICITY);
-                                sav->add_event(events_i[m]);
-                                sav->add_event(ej);
-                                sav->add_event(events_i[n]);
+    for (unsigned m = 0; m < events_i.size(); m++) {
+        for (unsigned n = m + 1; n < events_i.size(); n++) {
 
-                                bool existed = false;
-                                for (unsigned o = 0; o < savs.size(); o++) {
-                                    if (savs[o]->equals(sav)) {
-                                        existed = true;
-                                        break;
-                                    }
-                                }
-                                if (!existed) {
-                                    savs.push_back(sav);
-                                }
-                            }
-                        }
+            if (events_i[m]->mem != events_i[n]->mem) continue;
+
+            for (unsigned p = 0; p < events_j.size(); p++) {
+                struct Event * ej = events_j[p];
+
+                if (events_i[m]->mem != ej->mem) continue;
+
+                if (checkSAV(events_i[m], events_j[p], events_i[n])) {
+                    if (canFindOne(m, n, events_i, ej)) {
+                        Anomaly* sav = new Anomaly(S_ATOMICITY);
+                        sav->add_event(events_i[m]);
+                        sav->add_event(ej);
+                        sav->add_event(events_i[n]);
+                        found.push_back(sav);
                     }
                 }
             }
@@ -372,86 +448,118 @@ void predictSAVs() {
     }
 }
 
-void predictMAVs() {
-
+void predictSAVs() {
+    PredictTasks tasks;
     for (unsigned i = 0; i < threads.size(); i++) {
-        struct Thread * thread_i = threads[i];
-        vector<Event *> events_i = thread_i->events;
-        for (unsigned j = i + 1; j < threads.size(); j++) {
-            struct Thread * thread_j = threads[j];
-            vector<Event *> events_j = thread_j->events;
-
-            // find two from events_i 
-            for (unsigned m = 0; m < events_i.size(); m++) {
-                Event * em = events_i[m];
-                for (unsigned n = m + 1; n < events_i.size(); n++) {
-                    Event * en = events_i[n];
-                    if (em->mem == en->mem || em->type != en->type) continue;
-
-                    // find two from events_j
-                    for (unsigned p = 0; p < events_j.size(); p++) {
-                        Event * ep = events_j[p];
-                        if (ep->mem != em->mem && ep->mem != en->mem) continue;
-                        for (unsigned q = p + 1; q < events_j.size(); q++) {
-                            Event * eq = events_j[q];
-                            bool same_order = false;
-                            bool potential = false;
-
-                            if (ep->mem == eq->mem || ep->type != eq->type) continue;
-                            if (ep->mem == em->mem && eq->mem != en->mem) continue;
-                            if (ep->mem == en->mem && eq->mem != em->mem) continue;
-
-                            if (ep->mem == em->mem) same_order = true;
-
-                            if (checkMAV(em, en, ep, eq)) {
-                                if (same_order) {
-                                    if ((canFindOne(m, n, events_i, ep) && canFindOne(m, n, events_i, eq)) || (canFindOne(p, q, events_j, em) && canFindOne(p, q, events_j, en))) {
-                                        potential = true;
-                                    }
-                                } else {
-                                    if (canFindOne(m, n, events_i, ep) || canFindOne(p, q, events_j, em)) {
-                                        potential = true;
-                                    }
-                                }
-                            }
+        for (unsigned j = 0; j < threads.size(); j++) {
+            if (i == j) continue;
+
+            ThreadPair tp = {i, j};
+            tasks.pairs.push_back(tp);
+        }
+    }
+    tasks.found.resize(tasks.pairs.size());
+
+    ThreadPool pool(worker_num);
+    pool.run(tasks.pairs.size(), predictSAVsForPair, &tasks);
 
-                            if (potential) {
-                                //printf("[PECAN] [mAtomicity] Line %d\tLine %d\t Line %d\t Line %d.\n", em->line, en->line, ep->line, eq->line);
-                                fprintf(fout, "[mAtomicity] Line %ld\tLine %ld\t Line %ld\t Line %ld.\n", em->line, en->line, ep->line, eq->line);
-
-                                Anomaly* mav = new Anomaly(M_ATOMICITY);
-                                mav->add_event(em);
-                                mav->add_event(en);
-                                mav->add_event(ep);
-                                mav->add_event(eq);
-
-                                bool existed = false;
-                                for (unsigned o = 0; o < mavs.size(); o++) {
-                                    if (mavs[o]->equals(mav)) {
-                                        existed = true;
-                                        break;
-                                    }
-                                }
-                                if (!existed) {
-                                    mavs.push_back(mav);
-                                }
+    merge(tasks, savs);
+}
+
+void predictMAVsForPair(unsigned task, unsigned worker, void* arg) {
+    PredictTasks* tasks = (PredictTasks*) arg;
+    vector<Anomaly*>& found = tasks->found[task];
+
+    const vector<Event *>& events_i = threads[tasks->pairs[task].i]->events;
+    const vector<Event *>& events_j = threads[tasks->pairs[task].j]->events;
+
+    // find two from events_i 
+    for (unsigned m = 0; m < events_i.size(); m++) {
+        Event * em = events_i[m];
+        for (unsigned n = m + 1; n < events_i.size(); n++) {
+            Event * en = events_i[n];
+            if (em->mem == en->mem || em->type != en->type) continue;
+
+            // find two from events_j
+            for (unsigned p = 0; p < events_j.size(); p++) {
+                Event * ep = events_j[p];
+                if (ep->mem != em->mem && ep->mem != en->mem) continue;
+                for (unsigned q = p + 1; q < events_j.size(); q++) {
+                    Event * eq = events_j[q];
+                    bool same_order = false;
+                    bool potential = false;
+
+                    if (ep->mem == eq->mem || ep->type != eq->type) continue;
+                    if (ep->mem == em->mem && eq->mem != en->mem) continue;
+                    if (ep->mem == en->mem && eq->mem != em->mem) continue;
+
+                    if (ep->mem == em->mem) same_order = true;
+
+                    if (checkMAV(em, en, ep, eq)) {
+                        if (same_order) {
+                            if ((canFindOne(m, n, events_i, ep) && canFindOne(m, n, events_i, eq)) || (canFindOne(p, q, events_j, em) && canFindOne(p, q, events_j, en))) {
+                                potential = true;
+                            }
+                        } else {
+                            if (canFindOne(m, n, events_i, ep) || canFindOne(p, q, events_j, em)) {
+                                potential = true;
                             }
                         }
                     }
+
+                    if (potential) {
+                        Anomaly* mav = new Anomaly(M_ATOMICITY);
+                        mav->add_event(em);
+                        mav->add_event(en);
+                        mav->add_event(ep);
+                        mav->add_event(eq);
+                        found.push_back(mav);
+                    }
                 }
             }
+        }
+    }
+}
 
+void predictMAVs() {
+    PredictTasks tasks;
+    for (unsigned i = 0; i < threads.size(); i++) {
+        for (unsigned j = i + 1; j < threads.size(); j++) {
+            ThreadPair tp = {i, j};
+            tasks.pairs.push_back(tp);
         }
     }
+    tasks.found.resize(tasks.pairs.size());
+
+    ThreadPool pool(worker_num);
+    pool.run(tasks.pairs.size(), predictMAVsForPair, &tasks);
+
+    merge(tasks, mavs);
 }
 
 int main(int argc, char * argv[]) {
     printf("WARNING: current version may only work for some specific programs, because some hard codes exit.\n\n");
 
-    if (argc != 3) {
+    worker_num = ThreadPool::cores();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        switch (opt) {
+            case 'j':
+                worker_num = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (argc - optind != 2) {
         printf("Please provide two arguments, which indicate the input log file and the output result file, respectively.\n");
+        printf("Usage: pecan [-j <threads>] <log_file> <result_file>\n");
+        exit(-1);
     } else {
-        init(argv[1], argv[2]);
+        beginPhase();
+        init(argv[optind], argv[optind + 1]);
     }
 
     /* test boost graph
@@ -469,9 +577,21 @@ int main(int argc, char * argv[]) {
      boost::write_graphviz(out, *(hbgraph->self()));
      */
 
+    // the closure must be ready before it is shared by the workers
+    hbgraph->close();
+    endPhase("INIT");
+
+    beginPhase();
     predictDataRaces();
+    endPhase("DR");
+
+    beginPhase();
     predictSAVs();
+    endPhase("SAV");
+
+    beginPhase();
     predictMAVs();
+    endPhase("MAV");
 
     dump();
 }
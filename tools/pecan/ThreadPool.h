@@ -0,0 +1,141 @@
+/*
+ * File:   ThreadPool.h
+ *
+ * A small work-stealing thread pool used by pecan to distribute independent
+ * prediction tasks (e.g. thread pairs) across cores.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#ifndef THREADPOOL_HPP
+#define	THREADPOOL_HPP
+
+#include <pthread.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+/// Tasks are identified by indices in [0, task_num). Every worker owns a
+/// deque of task indices; it pops from the back of its own deque and, when
+/// the deque is empty, steals from the front of the other workers' deques.
+/// The function run(task, worker) is called exactly once per task.
+class ThreadPool {
+public:
+    typedef void (*TaskFunc)(unsigned task, unsigned worker, void* arg);
+
+private:
+    struct Worker {
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        deque<unsigned> tasks;
+        unsigned id;
+        ThreadPool* pool;
+    };
+
+    vector<Worker*> workers;
+    TaskFunc func;
+    void* func_arg;
+
+public:
+
+    ThreadPool(unsigned worker_num) : func(NULL), func_arg(NULL) {
+        if (worker_num == 0) worker_num = 1;
+
+        for (unsigned i = 0; i < worker_num; i++) {
+            Worker* w = new Worker;
+            pthread_mutex_init(&w->mutex, NULL);
+            w->id = i;
+            w->pool = this;
+            workers.push_back(w);
+        }
+    }
+
+    ~ThreadPool() {
+        for (unsigned i = 0; i < workers.size(); i++) {
+            pthread_mutex_destroy(&workers[i]->mutex);
+            delete workers[i];
+        }
+    }
+
+    unsigned size() {
+        return workers.size();
+    }
+
+    /// Run all the tasks and wait until they are finished.
+    /// Tasks are dealt to the workers round-robin first.
+    void run(unsigned task_num, TaskFunc f, void* arg) {
+        func = f;
+        func_arg = arg;
+
+        for (unsigned t = 0; t < task_num; t++) {
+            workers[t % workers.size()]->tasks.push_back(t);
+        }
+
+        if (workers.size() == 1) {
+            work(workers[0]);
+            return;
+        }
+
+        for (unsigned i = 0; i < workers.size(); i++) {
+            pthread_create(&workers[i]->thread, NULL, ThreadPool::entry, workers[i]);
+        }
+
+        for (unsigned i = 0; i < workers.size(); i++) {
+            pthread_join(workers[i]->thread, NULL);
+        }
+    }
+
+    /// The number of online processors, at least one.
+    static unsigned cores() {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return n > 0 ? (unsigned) n : 1;
+    }
+
+private:
+
+    static void* entry(void* w) {
+        Worker* worker = (Worker*) w;
+        worker->pool->work(worker);
+        return NULL;
+    }
+
+    bool pop(Worker* w, unsigned& task) {
+        bool ret = false;
+        pthread_mutex_lock(&w->mutex);
+        if (!w->tasks.empty()) {
+            task = w->tasks.back();
+            w->tasks.pop_back();
+            ret = true;
+        }
+        pthread_mutex_unlock(&w->mutex);
+        return ret;
+    }
+
+    bool steal(Worker* thief, unsigned& task) {
+        for (unsigned i = 1; i < workers.size(); i++) {
+            Worker* victim = workers[(thief->id + i) % workers.size()];
+
+            pthread_mutex_lock(&victim->mutex);
+            if (!victim->tasks.empty()) {
+                task = victim->tasks.front();
+                victim->tasks.pop_front();
+                pthread_mutex_unlock(&victim->mutex);
+                return true;
+            }
+            pthread_mutex_unlock(&victim->mutex);
+        }
+        return false;
+    }
+
+    void work(Worker* w) {
+        unsigned task;
+        while (pop(w, task) || steal(w, task)) {
+            func(task, w->id, func_arg);
+        }
+    }
+};
+
+#endif	/* THREADPOOL_HPP */
@@ -0,0 +1,197 @@
+/*
+ * A generator of synthetic trace.out files for pecan, used to benchmark
+ * pecan without compiling and running a program with canary.
+ *
+ * Developed by Qingkai Shi
+ * Copy Right by Prism Research Group, HKUST and State Key Lab for Novel Software Tech., Nanjing University.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TraceSupport/Event.h"
+
+using namespace std;
+
+#define MAIN_TID 1
+#define LOCK_BASE 0x10000
+#define COND_BASE 0x20000
+#define SITE_NUM 100
+
+/* ************************************************************************
+ * Options
+ * ************************************************************************/
+unsigned thread_num = 4; // not including the main thread
+unsigned event_num = 1000;
+unsigned address_num = 16;
+unsigned lock_num = 2;
+unsigned lock_density = 30; // % of accesses in critical sections
+unsigned notify_density = 0; // % of critical sections with a wait or a notify
+bool nested = false; // thread i forks thread i + 1 instead of the main thread forking all
+unsigned seed = 0;
+
+/* ************************************************************************
+ * Generation
+ * ************************************************************************/
+vector<Event> events;
+
+struct ThreadState {
+    pthread_t tid;
+    int lock; // the held lock, -1 if none
+    unsigned section; // accesses left in the critical section
+};
+
+void createEvent(pthread_t tid, int type, long mem, pthread_t synctid, long cond, long line) {
+    Event e;
+    memset(&e, 0, sizeof (Event));
+    e.eid = events.size();
+    e.tid = tid;
+    e.mem = mem;
+    e.type = type;
+    e.line = line;
+    e.lockset = 0;
+    e.synctid = synctid;
+    e.cond = (pthread_cond_t*) cond;
+    strcpy(e.srcfile, "synthetic.c");
+    events.push_back(e);
+}
+
+unsigned pick(unsigned n) {
+    return n ? (unsigned) rand() % n : 0;
+}
+
+/// One step of a worker: an access, or a lock operation around accesses.
+void step(ThreadState& t, vector<long>& notified) {
+    if (t.lock < 0 && lock_num && pick(100) < lock_density) {
+        t.lock = pick(lock_num);
+        t.section = 1 + pick(4);
+        createEvent(t.tid, ACQUIRE, LOCK_BASE + t.lock, 0, 0, 1 + pick(SITE_NUM));
+        return;
+    }
+
+    if (t.lock >= 0 && t.section == 0) {
+        if (pick(100) < notify_density) {
+            long cond = COND_BASE + t.lock;
+            // wait for a notification of another thread if there is one
+            bool waited = false;
+            for (unsigned i = 0; i < notified.size(); i++) {
+                if (notified[i] == cond) {
+                    createEvent(t.tid, WAIT, LOCK_BASE + t.lock, 0, cond, 1 + pick(SITE_NUM));
+                    notified.erase(notified.begin() + i);
+                    waited = true;
+                    break;
+                }
+            }
+            if (!waited) {
+                createEvent(t.tid, NOTIFY, LOCK_BASE + t.lock, 0, cond, 1 + pick(SITE_NUM));
+                notified.push_back(cond);
+            }
+        }
+        createEvent(t.tid, RELEASE, LOCK_BASE + t.lock, 0, 0, 1 + pick(SITE_NUM));
+        t.lock = -1;
+        return;
+    }
+
+    if (t.lock >= 0) t.section--;
+    createEvent(t.tid, pick(2) ? READ : WRITE, pick(address_num), 0, 0, 1 + pick(SITE_NUM));
+}
+
+void generate() {
+    vector<ThreadState> threads(thread_num);
+    for (unsigned i = 0; i < thread_num; i++) {
+        threads[i].tid = MAIN_TID + 1 + i;
+        threads[i].lock = -1;
+        threads[i].section = 0;
+    }
+
+    // forks
+    for (unsigned i = 0; i < thread_num; i++) {
+        pthread_t parent = nested && i > 0 ? threads[i - 1].tid : MAIN_TID;
+        createEvent(parent, FORK, 0, threads[i].tid, 0, 1 + pick(SITE_NUM));
+    }
+
+    // each worker needs at most a release and a join at the end
+    unsigned reserved = thread_num * 2;
+    vector<long> notified;
+    while (thread_num && events.size() + reserved < event_num) {
+        step(threads[pick(thread_num)], notified);
+    }
+
+    // release held locks and join in the reverse order of forks
+    for (unsigned i = thread_num; i > 0; i--) {
+        ThreadState& t = threads[i - 1];
+        if (t.lock >= 0) {
+            createEvent(t.tid, RELEASE, LOCK_BASE + t.lock, 0, 0, 1 + pick(SITE_NUM));
+            t.lock = -1;
+        }
+    }
+    for (unsigned i = thread_num; i > 0; i--) {
+        pthread_t parent = nested && i > 1 ? threads[i - 2].tid : MAIN_TID;
+        createEvent(parent, JOIN, 0, threads[i - 1].tid, 0, 1 + pick(SITE_NUM));
+    }
+}
+
+void usage() {
+    printf("Usage: tracegen [options] <log_file>\n");
+    printf("  -t <n>  number of forked threads (4)\n");
+    printf("  -n <n>  number of events (1000)\n");
+    printf("  -a <n>  number of shared addresses (16)\n");
+    printf("  -k <n>  number of locks (2)\n");
+    printf("  -l <n>  percentage of accesses that start a critical section (30)\n");
+    printf("  -w <n>  percentage of critical sections with a wait or a notify (0)\n");
+    printf("  -f      nested forks: thread i forks thread i + 1\n");
+    printf("  -s <n>  random seed (0)\n");
+}
+
+int main(int argc, char * argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:a:k:l:w:fs:")) != -1) {
+        switch (opt) {
+            case 't': thread_num = atoi(optarg);
+                break;
+            case 'n': event_num = atoi(optarg);
+                break;
+            case 'a': address_num = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'k': lock_num = atoi(optarg);
+                break;
+            case 'l': lock_density = atoi(optarg);
+                break;
+            case 'w': notify_density = atoi(optarg);
+                break;
+            case 'f': nested = true;
+                break;
+            case 's': seed = atoi(optarg);
+                break;
+            default:
+                usage();
+                exit(-1);
+        }
+    }
+
+    if (argc - optind != 1) {
+        usage();
+        exit(-1);
+    }
+
+    srand(seed);
+    generate();
+
+    FILE* fout = fopen(argv[optind], "wb");
+    if (!fout) {
+        printf("[TRACEGEN] Cannot open File %s!\n", argv[optind]);
+        exit(-1);
+    }
+
+    long output_num = events.size();
+    fwrite(&output_num, sizeof (long), 1, fout);
+    fwrite(events.data(), sizeof (struct Event), output_num, fout);
+    fclose(fout);
+
+    printf("[TRACEGEN] %ld events of %u threads are written into %s.\n", output_num, thread_num + 1, argv[optind]);
+    return 0;
+}
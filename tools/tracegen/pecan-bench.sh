@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# Run pecan on synthetic traces of increasing sizes, and record the time and
+# the peak memory of each phase (INIT, DR, SAV, MAV) into a csv file.
+#
+# Usage: pecan-bench.sh [-o <csv_file>] [-j <threads>] [<sizes>] [-- <tracegen options>]
+#   e.g. pecan-bench.sh -o bench.csv "500 1000 2000 4000" -- -t 8 -l 50
+
+csv=pecan-bench.csv
+jobs=""
+sizes="250 500 1000 2000"
+
+while [ $# -gt 0 ]; do
+    case $1 in
+        -o) csv=$2; shift 2;;
+        -j) jobs="-j $2"; shift 2;;
+        --) shift; break;;
+        *) sizes=$1; shift;;
+    esac
+done
+genopts="$@"
+
+for tool in tracegen pecan; do
+    if ! which $tool > /dev/null 2>&1; then
+        echo "Error: $tool does not exist! Termination."
+        exit -1
+    fi
+done
+
+workdir=`mktemp -d`
+echo "events,phase,seconds,peak_kb" > $csv
+
+prev_events=""
+for n in $sizes; do
+    tracegen $genopts -n $n $workdir/trace.out > /dev/null || exit -1
+    pecan $jobs $workdir/trace.out $workdir/result > $workdir/log 2>&1
+    exitcode=$?
+    if [ $exitcode != 0 ]; then
+        echo "pecan fails on $n events! Exit code: $exitcode."
+        cat $workdir/log
+        exit -1
+    fi
+
+    echo "==============================================="
+    echo "$n events: `tail -1 $workdir/result`"
+    sed -n 's/^\[PECAN\] Phase \([A-Z]*\): \([0-9.]*\) s, peak memory \([0-9]*\) KB\.$/\1 \2 \3/p' $workdir/log |
+    while read phase seconds kb; do
+        echo "$n,$phase,$seconds,$kb" >> $csv
+
+        # the growth of time from the previous size, e.g. 4 for a quadratic
+        # phase if the size doubles, to catch super-linear regressions
+        if [ -n "$prev_events" ]; then
+            prev=`grep "^$prev_events,$phase," $csv | cut -d, -f3`
+            growth=`awk -v a=$prev -v b=$seconds 'BEGIN { if (a > 0) printf "%.2f", b / a; else print "-" }'`
+        else
+            growth="-"
+        fi
+        printf "  %-5s %10.3f s %10d KB   x%s\n" $phase $seconds $kb $growth
+    done
+    prev_events=$n
+done
+
+rm -rf $workdir
+echo "==============================================="
+echo "Results are written into $csv."